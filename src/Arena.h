@@ -0,0 +1,213 @@
+/*
+ * Arena.h
+ */
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+/************************* Arena  **************************/
+
+/**
+ * Memory arena: hands out memory from large blocks and frees all of it at once (clear),
+ * so building a big structure takes a few allocations instead of one per element.
+ * Memory given back before clear is not reused, so containers kept in an arena should be
+ * reserved to their final size (ArenaAllocator)
+ */
+class Arena
+{
+    struct Block
+    {
+        char *data;
+        std::size_t size;
+        std::size_t used;
+    };
+
+    std::vector<Block> blocks;
+    std::size_t block_size;
+    std::size_t bytes_used = 0;
+
+    void addBlock(std::size_t size);
+
+public:
+    explicit Arena(std::size_t block_size = 1 << 20);
+    ~Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(std::size_t bytes, std::size_t alignment);
+    void reserve(std::size_t bytes);
+    void clear();
+
+    std::size_t getBytesUsed() const;
+    std::size_t getBytesReserved() const;
+    unsigned int getNumBlocks() const;
+};
+
+/************************* ArenaAllocator  **************************/
+
+/**
+ * Standard allocator that takes memory from an arena, for containers whose memory is freed with it.
+ * Deallocating does nothing
+ */
+template <class U>
+class ArenaAllocator
+{
+    Arena *arena;
+
+    template <class V>
+    friend class ArenaAllocator;
+
+public:
+    typedef U value_type;
+
+    ArenaAllocator(Arena *arena);
+    template <class V>
+    ArenaAllocator(const ArenaAllocator<V> &other);
+
+    U *allocate(std::size_t n);
+    void deallocate(U *pointer, std::size_t n);
+
+    template <class V>
+    bool operator==(const ArenaAllocator<V> &other) const;
+    template <class V>
+    bool operator!=(const ArenaAllocator<V> &other) const;
+};
+
+template <class U>
+using ArenaVector = std::vector<U, ArenaAllocator<U>>;
+
+/**
+ * .cpp
+*/
+
+inline Arena::Arena(std::size_t block_size) : block_size(block_size) {}
+
+inline Arena::~Arena()
+{
+    clear();
+}
+
+inline void Arena::addBlock(std::size_t size)
+{
+    Block block;
+    block.data = static_cast<char *>(std::malloc(size));
+    if (block.data == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    block.size = size;
+    block.used = 0;
+    blocks.push_back(block);
+}
+
+/**
+ * Memory for bytes with the given alignment (a power of two) from the last block,
+ * or from a new block if it does not fit
+ */
+inline void *Arena::allocate(std::size_t bytes, std::size_t alignment)
+{
+    if (!blocks.empty())
+    {
+        Block &block = blocks.back();
+        std::size_t start = (block.used + alignment - 1) & ~(alignment - 1);
+        if (start + bytes <= block.size)
+        {
+            block.used = start + bytes;
+            bytes_used += bytes;
+            return block.data + start;
+        }
+    }
+
+    // malloc aligns to any standard type
+    addBlock(std::max(block_size, bytes));
+    blocks.back().used = bytes;
+    bytes_used += bytes;
+    return blocks.back().data;
+}
+
+/**
+ * Makes sure the next allocations, of up to bytes in total (plus alignment), fit in one block
+ */
+inline void Arena::reserve(std::size_t bytes)
+{
+    if (blocks.empty() || blocks.back().size - blocks.back().used < bytes)
+    {
+        addBlock(std::max(block_size, bytes));
+    }
+}
+
+/**
+ * Frees all the memory of the arena. Containers using it must be emptied first
+ */
+inline void Arena::clear()
+{
+    for (Block &block : blocks)
+    {
+        std::free(block.data);
+    }
+    blocks.clear();
+    bytes_used = 0;
+}
+
+/**
+ * Bytes handed out since the last clear
+ */
+inline std::size_t Arena::getBytesUsed() const
+{
+    return bytes_used;
+}
+
+/**
+ * Bytes taken from the system, including the unused end of each block
+ */
+inline std::size_t Arena::getBytesReserved() const
+{
+    std::size_t bytes = 0;
+    for (const Block &block : blocks)
+    {
+        bytes += block.size;
+    }
+    return bytes;
+}
+
+inline unsigned int Arena::getNumBlocks() const
+{
+    return blocks.size();
+}
+
+template <class U>
+ArenaAllocator<U>::ArenaAllocator(Arena *arena) : arena(arena) {}
+
+template <class U>
+template <class V>
+ArenaAllocator<U>::ArenaAllocator(const ArenaAllocator<V> &other) : arena(other.arena) {}
+
+template <class U>
+U *ArenaAllocator<U>::allocate(std::size_t n)
+{
+    return static_cast<U *>(arena->allocate(n * sizeof(U), alignof(U)));
+}
+
+template <class U>
+void ArenaAllocator<U>::deallocate(U *, std::size_t) {}
+
+template <class U>
+template <class V>
+bool ArenaAllocator<U>::operator==(const ArenaAllocator<V> &other) const
+{
+    return arena == other.arena;
+}
+
+template <class U>
+template <class V>
+bool ArenaAllocator<U>::operator!=(const ArenaAllocator<V> &other) const
+{
+    return arena != other.arena;
+}
+
+#endif /* ARENA_H_ */
@@ -0,0 +1,224 @@
+/*
+ * DistanceCache.h
+ */
+#ifndef DISTANCECACHE_H_
+#define DISTANCECACHE_H_
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#define DISTANCE_CACHE_MAGIC 0x43444842 // "BHDC"
+#define DISTANCE_CACHE_VERSION 1
+
+/************************* DistanceCache  **************************/
+
+/**
+ * Shortest distances between vertices of one map, kept in a binary file between runs.
+ * The file is tied to the checksum of the map files (Graph::getChecksum), so it is ignored
+ * when the map changes. Distances are stored by source vertex id, then by target vertex id.
+ * File layout (native byte order): magic, version, checksum, number of sources and, for each
+ * source, its id, number of targets and the (target id, distance) pairs.
+ * Lookups and inserts may come from several threads at once
+ */
+template <class T>
+class DistanceCache
+{
+    std::unordered_map<T, std::unordered_map<T, double>> rows;
+    std::uint64_t checksum = 0;
+    std::string filename;
+    bool changed = false;
+    mutable std::mutex mutex;
+
+public:
+    DistanceCache();
+    void open(const std::string &filename, std::uint64_t checksum);
+    bool save();
+    void clear();
+
+    bool lookup(const std::vector<T> &vertices, std::vector<double> &distances, std::vector<bool> &known) const;
+    void insert(const std::vector<T> &vertices, const std::vector<double> &distances, const std::vector<bool> &computed);
+    unsigned long long size() const;
+};
+
+/**
+ * .cpp
+*/
+template <class T>
+DistanceCache<T>::DistanceCache() {}
+
+template <class T>
+void DistanceCache<T>::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    rows.clear();
+    changed = false;
+}
+
+/**
+ * Loads the cache file of a map. A missing file, or one made for other map files, gives an empty cache
+ */
+template <class T>
+void DistanceCache<T>::open(const std::string &filename, std::uint64_t checksum)
+{
+    clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    this->filename = filename;
+    this->checksum = checksum;
+
+    std::ifstream file(filename, std::ios::binary);
+    std::uint32_t magic = 0, version = 0;
+    std::uint64_t file_checksum = 0, number_of_sources = 0;
+    file.read((char *)&magic, sizeof(magic));
+    file.read((char *)&version, sizeof(version));
+    file.read((char *)&file_checksum, sizeof(file_checksum));
+    file.read((char *)&number_of_sources, sizeof(number_of_sources));
+    if (!file || magic != DISTANCE_CACHE_MAGIC || version != DISTANCE_CACHE_VERSION || file_checksum != checksum)
+    {
+        return;
+    }
+
+    for (std::uint64_t s = 0; s < number_of_sources && file; s++)
+    {
+        T source;
+        std::uint64_t number_of_targets = 0;
+        file.read((char *)&source, sizeof(source));
+        file.read((char *)&number_of_targets, sizeof(number_of_targets));
+        std::unordered_map<T, double> &row = rows[source];
+        row.reserve(number_of_targets);
+        for (std::uint64_t t = 0; t < number_of_targets && file; t++)
+        {
+            T target;
+            double distance;
+            file.read((char *)&target, sizeof(target));
+            file.read((char *)&distance, sizeof(distance));
+            row[target] = distance;
+        }
+    }
+
+    if (!file)
+    {
+        // truncated file, start again
+        rows.clear();
+    }
+}
+
+/**
+ * Writes the cache file if there are new distances. The file is replaced only once
+ * it is completely written. Returns false if it could not be written
+ */
+template <class T>
+bool DistanceCache<T>::save()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!changed || filename.empty())
+    {
+        return true;
+    }
+
+    std::string temporary_filename = filename + ".tmp";
+    std::ofstream file(temporary_filename, std::ios::binary | std::ios::trunc);
+    std::uint32_t magic = DISTANCE_CACHE_MAGIC, version = DISTANCE_CACHE_VERSION;
+    std::uint64_t number_of_sources = rows.size();
+    file.write((const char *)&magic, sizeof(magic));
+    file.write((const char *)&version, sizeof(version));
+    file.write((const char *)&checksum, sizeof(checksum));
+    file.write((const char *)&number_of_sources, sizeof(number_of_sources));
+    for (auto &row : rows)
+    {
+        std::uint64_t number_of_targets = row.second.size();
+        file.write((const char *)&row.first, sizeof(row.first));
+        file.write((const char *)&number_of_targets, sizeof(number_of_targets));
+        for (auto &entry : row.second)
+        {
+            file.write((const char *)&entry.first, sizeof(entry.first));
+            file.write((const char *)&entry.second, sizeof(entry.second));
+        }
+    }
+    file.close();
+
+    if (!file || std::rename(temporary_filename.c_str(), filename.c_str()) != 0)
+    {
+        std::remove(temporary_filename.c_str());
+        return false;
+    }
+    changed = false;
+    return true;
+}
+
+/**
+ * Fills the entries of a row-major matrix between the given vertices that are in the cache
+ * and marks them as known. Returns true if all entries are known
+ */
+template <class T>
+bool DistanceCache<T>::lookup(const std::vector<T> &vertices, std::vector<double> &distances, std::vector<bool> &known) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    unsigned int n = vertices.size();
+    bool all_known = true;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        auto row = rows.find(vertices[i]);
+        for (unsigned int j = 0; j < n; j++)
+        {
+            if (known[i * n + j])
+            {
+                continue;
+            }
+            if (row != rows.end())
+            {
+                auto entry = row->second.find(vertices[j]);
+                if (entry != row->second.end())
+                {
+                    distances[i * n + j] = entry->second;
+                    known[i * n + j] = true;
+                    continue;
+                }
+            }
+            all_known = false;
+        }
+    }
+    return all_known;
+}
+
+/**
+ * Adds the computed entries of a row-major matrix between the given vertices
+ */
+template <class T>
+void DistanceCache<T>::insert(const std::vector<T> &vertices, const std::vector<double> &distances, const std::vector<bool> &computed)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    unsigned int n = vertices.size();
+    for (unsigned int i = 0; i < n; i++)
+    {
+        for (unsigned int j = 0; j < n; j++)
+        {
+            if (computed[i * n + j])
+            {
+                rows[vertices[i]][vertices[j]] = distances[i * n + j];
+                changed = true;
+            }
+        }
+    }
+}
+
+/**
+ * Number of distances in the cache
+ */
+template <class T>
+unsigned long long DistanceCache<T>::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    unsigned long long size = 0;
+    for (auto &row : rows)
+    {
+        size += row.second.size();
+    }
+    return size;
+}
+
+#endif /* DISTANCECACHE_H_ */
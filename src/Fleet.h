@@ -0,0 +1,325 @@
+/*
+ * Fleet.h
+ */
+#ifndef FLEET_H_
+#define FLEET_H_
+
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+
+/************************* Bus  **************************/
+template <class T>
+struct Bus
+{
+    T id;
+    T capacity;
+    std::vector<T> path;     // garage, bus stops and company visited, in order
+    std::vector<T> geometry; // every vertex driven through along the path
+};
+
+// largest dynamic programming tables, in bytes, before switching to branch and bound
+#define MAX_FLEET_TABLE_BYTES (8 << 20)
+
+/************************* Fleet sizing  **************************/
+
+/**
+ * Branch and bound over the capacities (biggest first) for selectCapacities,
+ * used when the dynamic programming table would be too big
+ */
+template <class T>
+void selectCapacitiesBranch(const std::vector<std::pair<T, unsigned int>> &groups, unsigned int group, T remaining,
+                            unsigned int buses, std::vector<unsigned int> &counts, bool fewest_buses,
+                            std::vector<unsigned int> &best_counts, unsigned int &best_buses, T &best_spare)
+{
+    if (remaining <= 0)
+    {
+        bool better = fewest_buses ? buses < best_buses || (buses == best_buses && -remaining < best_spare)
+                                   : -remaining < best_spare || (-remaining == best_spare && buses < best_buses);
+        if (better)
+        {
+            best_buses = buses;
+            best_spare = -remaining;
+            best_counts = counts;
+        }
+        return;
+    }
+    if (group == groups.size())
+    {
+        return;
+    }
+
+    // the biggest capacity left gives a lower bound on the buses still needed
+    T capacity = groups[group].first;
+    unsigned int needed = (remaining + capacity - 1) / capacity;
+    if ((fewest_buses && buses + needed > best_buses) || best_spare == 0)
+    {
+        return;
+    }
+
+    unsigned int max_count = std::min<unsigned int>(groups[group].second, needed);
+    for (unsigned int count = max_count + 1; count-- > 0;)
+    {
+        counts[group] = count;
+        selectCapacitiesBranch(groups, group + 1, remaining - count * capacity, buses + count, counts, fewest_buses,
+                               best_counts, best_buses, best_spare);
+    }
+    counts[group] = 0;
+}
+
+/**
+ * Fleet sizing: given the number of available buses of each capacity, chooses how many of each
+ * to use so their capacity covers the workers with the fewest buses and, among those,
+ * the fewest empty seats (or the fewest empty seats first, if fewest_buses is false).
+ * Bounded knapsack over the total capacity (no optimal choice reaches workers + biggest capacity),
+ * or branch and bound when that table is too big.
+ * Returns the number of buses of each capacity, empty if the buses are not enough
+ */
+template <class T>
+std::map<T, unsigned int> selectCapacities(const std::map<T, unsigned int> &available, T number_of_workers,
+                                           bool fewest_buses = true)
+{
+    std::map<T, unsigned int> selected;
+    if (number_of_workers <= 0 || available.empty())
+    {
+        return selected;
+    }
+
+    // biggest capacities first
+    std::vector<std::pair<T, unsigned int>> groups(available.rbegin(), available.rend());
+    T max_capacity = groups[0].first;
+    unsigned long long size = number_of_workers + max_capacity;
+
+    // used (capacities x seats) plus buses and previous (seats each)
+    if ((groups.size() + 2) * size * sizeof(unsigned int) > MAX_FLEET_TABLE_BYTES)
+    {
+        std::vector<unsigned int> counts(groups.size(), 0), best_counts;
+        unsigned int best_buses = std::numeric_limits<unsigned int>::max();
+        T best_spare = std::numeric_limits<T>::max();
+        selectCapacitiesBranch(groups, 0, number_of_workers, 0, counts, fewest_buses, best_counts, best_buses, best_spare);
+        for (unsigned int g = 0; g < best_counts.size(); g++)
+        {
+            if (best_counts[g] > 0)
+            {
+                selected[groups[g].first] = best_counts[g];
+            }
+        }
+        return selected;
+    }
+
+    // buses[s]: fewest buses with exactly s seats, used[g * size + s]: buses of group g in that choice
+    const unsigned int NONE = std::numeric_limits<unsigned int>::max();
+    std::vector<unsigned int> buses(size, NONE), previous;
+    std::vector<unsigned int> used(groups.size() * size, 0);
+    buses[0] = 0;
+
+    for (unsigned int g = 0; g < groups.size(); g++)
+    {
+        T capacity = groups[g].first;
+        previous = buses;
+        for (unsigned long long seats = capacity; seats < size; seats++)
+        {
+            for (unsigned int count = 1; count <= groups[g].second && (unsigned long long)count * capacity <= seats; count++)
+            {
+                unsigned int before = previous[seats - count * capacity];
+                if (before != NONE && before + count < buses[seats])
+                {
+                    buses[seats] = before + count;
+                    used[g * size + seats] = count;
+                }
+            }
+        }
+    }
+
+    unsigned long long best_seats = size;
+    for (unsigned long long seats = number_of_workers; seats < size; seats++)
+    {
+        if (buses[seats] != NONE && (best_seats == size || (fewest_buses && buses[seats] < buses[best_seats])))
+        {
+            best_seats = seats;
+        }
+    }
+    if (best_seats == size)
+    {
+        return selected;
+    }
+
+    for (unsigned int g = groups.size(); g-- > 0;)
+    {
+        unsigned int count = used[g * size + best_seats];
+        if (count > 0)
+        {
+            selected[groups[g].first] = count;
+            best_seats -= count * groups[g].first;
+        }
+    }
+    return selected;
+}
+
+/************************* Fleet  **************************/
+
+/**
+ * Index over the buses of the manager: available buses ordered by capacity
+ * and the buses assigned to each company (by company index, two companies may share a vertex).
+ * Allocating and releasing a bus is O(log number of buses)
+ */
+template <class T>
+class Fleet
+{
+    std::multimap<T, Bus<T> *> available;                   // available buses by capacity
+    std::unordered_map<unsigned int, std::vector<Bus<T> *>> assigned; // buses of each company
+    T available_capacity = 0;
+
+    void makeAvailable(Bus<T> *bus);
+
+public:
+    Fleet();
+    void build(std::vector<Bus<T>> &buses);
+
+    T getAvailableCapacity() const;
+    std::map<T, unsigned int> getAvailableCapacities() const;
+    std::vector<Bus<T> *> allocate(unsigned int company, T number_of_workers, T reserved_capacity = 0);
+    void release(unsigned int company, Bus<T> *bus);
+    void releaseAll(unsigned int company);
+    std::vector<Bus<T> *> getAssigned(unsigned int company) const;
+};
+
+/**
+ * .cpp
+*/
+template <class T>
+Fleet<T>::Fleet() {}
+
+template <class T>
+void Fleet<T>::makeAvailable(Bus<T> *bus)
+{
+    available.insert({bus->capacity, bus});
+    available_capacity += bus->capacity;
+}
+
+/**
+ * Indexes all buses as available. Must be called again whenever the buses vector changes,
+ * since the index keeps pointers to its elements
+ */
+template <class T>
+void Fleet<T>::build(std::vector<Bus<T>> &buses)
+{
+    available.clear();
+    assigned.clear();
+    available_capacity = 0;
+    for (Bus<T> &bus : buses)
+    {
+        makeAvailable(&bus);
+    }
+}
+
+template <class T>
+T Fleet<T>::getAvailableCapacity() const
+{
+    return available_capacity;
+}
+
+/**
+ * Number of available buses of each capacity
+ */
+template <class T>
+std::map<T, unsigned int> Fleet<T>::getAvailableCapacities() const
+{
+    std::map<T, unsigned int> capacities;
+    for (auto it = available.begin(); it != available.end(); it = available.upper_bound(it->first))
+    {
+        capacities[it->first] = available.count(it->first);
+    }
+    return capacities;
+}
+
+/**
+ * Assigns to a company the fewest buses that carry all its workers, with the fewest empty seats
+ * (selectCapacities). If that leaves less than reserved_capacity seats available for other companies,
+ * the buses with the fewest empty seats are chosen instead.
+ * Returns no buses if the available capacity is not enough
+ */
+template <class T>
+std::vector<Bus<T> *> Fleet<T>::allocate(unsigned int company, T number_of_workers, T reserved_capacity)
+{
+    std::vector<Bus<T> *> buses;
+    if (number_of_workers > available_capacity)
+    {
+        return buses;
+    }
+
+    std::map<T, unsigned int> capacities = getAvailableCapacities();
+    std::map<T, unsigned int> selected = selectCapacities(capacities, number_of_workers);
+    T selected_capacity = 0;
+    for (auto &selection : selected)
+    {
+        selected_capacity += selection.first * selection.second;
+    }
+    if (available_capacity - selected_capacity < reserved_capacity)
+    {
+        selected = selectCapacities(capacities, number_of_workers, false);
+    }
+    // biggest buses first
+    for (auto it = selected.rbegin(); it != selected.rend(); ++it)
+    {
+        for (unsigned int i = 0; i < it->second; i++)
+        {
+            auto bus = available.find(it->first);
+            available_capacity -= bus->first;
+            buses.push_back(bus->second);
+            available.erase(bus);
+        }
+    }
+
+    std::vector<Bus<T> *> &company_buses = assigned[company];
+    company_buses.insert(company_buses.end(), buses.begin(), buses.end());
+    return buses;
+}
+
+/**
+ * Gives back a bus the company did not need
+ */
+template <class T>
+void Fleet<T>::release(unsigned int company, Bus<T> *bus)
+{
+    std::vector<Bus<T> *> &company_buses = assigned[company];
+    for (unsigned int i = 0; i < company_buses.size(); i++)
+    {
+        if (company_buses[i] == bus)
+        {
+            company_buses.erase(company_buses.begin() + i);
+            makeAvailable(bus);
+            return;
+        }
+    }
+}
+
+template <class T>
+void Fleet<T>::releaseAll(unsigned int company)
+{
+    auto it = assigned.find(company);
+    if (it == assigned.end())
+    {
+        return;
+    }
+    for (Bus<T> *bus : it->second)
+    {
+        makeAvailable(bus);
+    }
+    assigned.erase(it);
+}
+
+template <class T>
+std::vector<Bus<T> *> Fleet<T>::getAssigned(unsigned int company) const
+{
+    auto it = assigned.find(company);
+    if (it == assigned.end())
+    {
+        return std::vector<Bus<T> *>();
+    }
+    return it->second;
+}
+
+#endif /* FLEET_H_ */
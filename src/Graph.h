@@ -1,446 +1,2066 @@
-/*
- * Graph.h
- */
-#ifndef GRAPH_H_
-#define GRAPH_H_
-
-#include <vector>
-#include <queue>
-#include <list>
-#include <limits>
-#include <cmath>
-#include <string>
-#include <sstream>
-#include <fstream>
-#include <unordered_set>
-#include "MutablePriorityQueue.h"
-#include "lib/graphviewer.h"
-
-template <class T>
-class Edge;
-template <class T>
-class Graph;
-template <class T>
-class Vertex;
-
-#define INF std::numeric_limits<double>::max()
-
-/************************* Vertex  **************************/
-
-template <class T>
-class Vertex
-{
-	T info;					   // content of the vertex
-	vector<Edge<T>> edges_out; // outgoing edges
-
-	double x, y; // x and y coordinates
-
-	double dist = 0;
-	Vertex<T> *path = NULL;
-	int queueIndex = 0; // required by MutablePriorityQueue
-
-	bool visited = false;	 // auxiliary field
-	bool processing = false; // auxiliary field
-
-	void addEdge(Vertex<T> *dest, double w);
-
-public:
-	Vertex(T in, double x, double y);
-	T getInfo() const;
-	double getDist() const;
-	Vertex *getPath() const;
-	std::vector<Edge<T>> getEdgesOut() const;
-
-	bool operator<(Vertex<T> &vertex) const; // // required by MutablePriorityQueue
-	friend class Graph<T>;
-	friend class MutablePriorityQueue<Vertex<T>>;
-};
-
-template <class T>
-Vertex<T>::Vertex(T in, double x, double y) : info(in), x(x), y(y) {}
-
-/*
- * Auxiliary function to add an outgoing edge to a vertex (this),
- * with a given destination vertex (d) and edge weight (w).
- */
-template <class T>
-void Vertex<T>::addEdge(Vertex<T> *d, double w)
-{
-	edges_out.push_back(Edge<T>(d, w));
-}
-
-template <class T>
-bool Vertex<T>::operator<(Vertex<T> &vertex) const
-{
-	return this->dist < vertex.dist;
-}
-
-template <class T>
-T Vertex<T>::getInfo() const
-{
-	return this->info;
-}
-
-template <class T>
-double Vertex<T>::getDist() const
-{
-	return this->dist;
-}
-
-template <class T>
-Vertex<T> *Vertex<T>::getPath() const
-{
-	return this->path;
-}
-
-template <class T>
-std::vector<Edge<T>> Vertex<T>::getEdgesOut() const
-{
-	return this->edges_out;
-}
-
-/********************** Edge  ****************************/
-
-template <class T>
-class Edge
-{
-	Vertex<T> *dest; // destination vertex
-	double weight;	 // edge weight
-public:
-	Edge(Vertex<T> *d, double w);
-	friend class Graph<T>;
-	friend class Vertex<T>;
-};
-
-template <class T>
-Edge<T>::Edge(Vertex<T> *d, double w) : dest(d), weight(w) {}
-
-/*************************** Graph  **************************/
-
-template <class T>
-class Graph
-{
-	vector<Vertex<T> *> vertexSet; // vertex set
-
-	Vertex<T> *initSingleSource(const T &orig);
-	bool relax(Vertex<T> *v, Vertex<T> *w, double weight);
-
-public:
-	Graph();
-	Vertex<T> *findVertex(const T &in) const;
-	bool addVertex(const T &in, double x, double y);
-	bool addEdge(const T &sourc, const T &dest);
-	int getNumVertex() const;
-	vector<Vertex<T> *> getVertexSet() const;
-
-	void dijkstraShortestPath(const T &s);
-	vector<T> getPathTo(const T &dest) const;
-
-	bool isConnected(T origin) const;
-	void dfs(Vertex<T> *vertex) const;
-
-	void loadNodesAndEdges(string city_name);
-	void drawGraph(GraphViewer *gv);
-};
-
-template <class T>
-Graph<T>::Graph() {}
-
-/**
- * Initializes single-source shortest path data (path, dist).
- * Receives the content of the source vertex and returns a pointer to the source vertex.
- * Used by all single-source shortest path algorithms.
- */
-template <class T>
-Vertex<T> *Graph<T>::initSingleSource(const T &origin)
-{
-	for (auto v : vertexSet)
-	{
-		v->dist = INF;
-		v->path = nullptr;
-	}
-	auto s = findVertex(origin);
-	s->dist = 0;
-	return s;
-}
-
-/**
- * Analyzes an edge in single-source shortest path algorithm.
- * Returns true if the target vertex was relaxed (dist, path).
- * Used by all single-source shortest path algorithms.
- */
-template <class T>
-bool Graph<T>::relax(Vertex<T> *v, Vertex<T> *w, double weight)
-{
-	if (v->dist + weight < w->dist)
-	{
-		w->dist = v->dist + weight;
-		w->path = v;
-		return true;
-	}
-	else
-		return false;
-}
-
-template <class T>
-int Graph<T>::getNumVertex() const
-{
-	return vertexSet.size();
-}
-
-template <class T>
-vector<Vertex<T> *> Graph<T>::getVertexSet() const
-{
-	return vertexSet;
-}
-
-/*
- * Auxiliary function to find a vertex with a given content.
- */
-template <class T>
-Vertex<T> *Graph<T>::findVertex(const T &in) const
-{
-	for (auto v : vertexSet)
-		if (v->info == in)
-			return v;
-	return NULL;
-}
-
-/*
- *  Adds a vertex with a given content or info (in) to a graph (this).
- *  Returns true if successful, and false if a vertex with that content already exists.
- */
-template <class T>
-bool Graph<T>::addVertex(const T &in, double x, double y)
-{
-	if (findVertex(in) != NULL)
-		return false;
-	vertexSet.push_back(new Vertex<T>(in, x, y));
-	return true;
-}
-
-/*
- * Adds an edge to a graph (this), given the contents of the source and
- * destination vertices and the edge weight (w).
- * Returns true if successful, and false if the source or destination vertex does not exist.
- */
-template <class T>
-bool Graph<T>::addEdge(const T &sourc, const T &dest)
-{
-	auto v1 = findVertex(sourc);
-	auto v2 = findVertex(dest);
-	if (v1 == NULL || v2 == NULL)
-		return false;
-	double weight = sqrt(pow(v1->x - v2->x, 2) + pow(v1->y - v2->y, 2));
-	v1->addEdge(v2, weight);
-	return true;
-}
-
-/**
- * Dijkstra algorithm.
- */
-template <class T>
-void Graph<T>::dijkstraShortestPath(const T &origin)
-{
-	auto s = initSingleSource(origin);
-	MutablePriorityQueue<Vertex<T>> q;
-	q.insert(s);
-	while (!q.empty())
-	{
-		auto v = q.extractMin();
-		for (auto edge : v->edges_out)
-		{
-			auto oldDist = edge.dest->dist;
-			if (relax(v, edge.dest, edge.weight))
-			{
-				if (oldDist == INF)
-					q.insert(edge.dest);
-				else
-					q.decreaseKey(edge.dest);
-			}
-		}
-	}
-}
-
-template <class T>
-vector<T> Graph<T>::getPathTo(const T &dest) const
-{
-	vector<T> res;
-	auto current = findVertex(dest);
-	while (current != NULL)
-	{
-		res.insert(res.begin(), current->info);
-		current = current->path;
-	}
-	return res;
-}
-
-template <class T>
-bool Graph<T>::isConnected(T origin) const
-{
-	// reset visited values
-	for (unsigned int i = 0; i < vertexSet.size(); i++)
-	{
-		vertexSet[i]->visited = false;
-	}
-
-	Vertex<T> *origin_vertex = findVertex(origin);
-
-	dfs(origin_vertex);
-
-	for (Vertex<T> *vertex : vertexSet)
-	{
-		if (!vertex->visited)
-		{
-			return false;
-		}
-	}
-
-	return true;
-}
-
-template <class T>
-void Graph<T>::dfs(Vertex<T> *vertex) const
-{
-	if (vertex->visited)
-	{
-		return;
-	}
-	vertex->visited = true;
-
-	for (Edge<T> edge : vertex->getEdgesOut())
-	{
-		dfs(edge.dest);
-	}
-}
-
-/**
- * Load vertices and edges from .txt files and store them in the graph
-*/
-template <class T>
-void Graph<T>::loadNodesAndEdges(string city_name)
-{
-	std::string nodes_filename, edges_filename;
-	std::ifstream nodes, edges;
-	int edgeType;
-
-	if (city_name == "testing")
-	{
-		nodes_filename = "resources/Mapas-20200424/GridGraphs/16x16/nodes.txt";
-		edges_filename = "resources/Mapas-20200424/GridGraphs/16x16/edges.txt";
-	}
-	else if (city_name.find("full") != std::string::npos || city_name.find("strong") != std::string::npos)
-	{
-		std::size_t pos = city_name.find("_");
-		string city_name_uppercase = city_name.substr(0, pos);
-		city_name_uppercase[0] = toupper(city_name_uppercase[0]);
-
-		nodes_filename = "resources/Mapas-20200424/PortugalMaps/PortugalMaps/New Maps/" + city_name_uppercase + "-20200523/" + city_name + "_nodes_xy.txt";
-		edges_filename = "resources/Mapas-20200424/PortugalMaps/PortugalMaps/New Maps/" + city_name_uppercase + "-20200523/" + city_name + "_edges.txt";
-		;
-	}
-	else
-	{
-		string city_name_lowercase = city_name;
-		city_name_lowercase[0] = tolower(city_name_lowercase[0]);
-
-		nodes_filename = "resources/Mapas-20200424/PortugalMaps/PortugalMaps/" + city_name + "/nodes_x_y_" + city_name_lowercase + ".txt";
-		edges_filename = "resources/Mapas-20200424/PortugalMaps/PortugalMaps/" + city_name + "/edges_" + city_name_lowercase + ".txt";
-	}
-
-	// UNDIRECTED com grids, DIRECTED com maps
-	// professor deu-nos permissao para usar UNDIRECTED em todos os mapas devido à má conetividade
-	edgeType = EdgeType::UNDIRECTED;
-
-	nodes.open(nodes_filename);
-	if (!nodes.good())
-	{
-		std::cout << "Unable to access file " << nodes_filename << std::endl;
-		return;
-	}
-
-	edges.open(edges_filename);
-	if (!edges.good())
-	{
-		std::cout << "Unable to access file " << edges_filename << std::endl;
-		return;
-	}
-
-	std::string line;
-	std::istringstream iss;
-	unsigned int node_id, n_nodes, n_edges, node_id_origin, node_id_destination;
-	double x, y;
-
-	// read num of nodes
-	std::getline(nodes, line);
-	iss.str(line);
-	iss >> n_nodes;
-
-	// load nodes
-	for (unsigned int i = 0; i < n_nodes; i++)
-	{
-		std::getline(nodes, line);
-		sscanf(line.c_str(), "(%d, %lf, %lf)", &node_id, &x, &y);
-		addVertex(node_id, x, y);
-	}
-
-	// read num of edges
-	std::getline(edges, line);
-	sscanf(line.c_str(), "%d", &n_edges);
-
-	//load edges
-	for (unsigned int i = 0; i < n_edges; i++)
-	{
-		std::getline(edges, line);
-		sscanf(line.c_str(), "(%d, %d)", &node_id_origin, &node_id_destination);
-		if (edgeType == EdgeType::UNDIRECTED)
-		{
-			addEdge(node_id_destination, node_id_origin);
-		}
-		addEdge(node_id_origin, node_id_destination);
-	}
-
-	nodes.close();
-	edges.close();
-}
-
-/** 
- * Draw all vertices and edges of the map
-*/
-template <class T>
-void Graph<T>::drawGraph(GraphViewer *gv)
-{
-	double relative_x, relative_y;
-	unsigned int edge_id = 0;
-
-	// add vertices
-	for (unsigned int i = 0; i < vertexSet.size(); i++)
-	{
-		Vertex<T> *vertex = vertexSet[i];
-
-		if (i == 0)
-		{
-			relative_x = vertex->x;
-			relative_y = vertex->y;
-		}
-
-		gv->addNode(vertex->info, vertex->x - relative_x, vertex->y - relative_y);
-		gv->setVertexSize(vertex->info, 16);
-	}
-
-	// add edges
-	for (unsigned int i = 0; i < vertexSet.size(); i++)
-	{
-		Vertex<T> *vertex = vertexSet[i];
-
-		for (auto edge : vertex->edges_out)
-		{
-			gv->addEdge(edge_id, vertex->info, edge.dest->info, EdgeType::DIRECTED);
-			++edge_id;
-		}
-	}
-
-	gv->rearrange();
-}
-
-#endif /* GRAPH_H_ */
+/*
+ * Graph.h
+ */
+#ifndef GRAPH_H_
+#define GRAPH_H_
+
+#include <vector>
+#include <queue>
+#include <list>
+#include <limits>
+#include <cmath>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <unordered_set>
+#include <unordered_map>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+#include "Arena.h"
+#include "lib/graphviewer.h"
+
+template <class T>
+class Edge;
+template <class T, class W, class Direction>
+class Graph;
+
+/*
+ * FNV-1a hash of a line, combined with the hash of the lines before it (hash).
+ */
+inline std::uint64_t hashLine(std::uint64_t hash, const std::string &line)
+{
+	for (unsigned char c : line)
+	{
+		hash ^= c;
+		hash *= 1099511628211ULL;
+	}
+	hash ^= '\n';
+	return hash * 1099511628211ULL;
+}
+
+/************************* Graph policies  **************************/
+
+// integer weights are in fixed point, in 1/WEIGHT_SCALE of the map units (centimetres on the maps
+// in metres): each weight is rounded to that precision
+#define WEIGHT_SCALE 100
+
+/**
+ * Arithmetic of a weight type W (double, float or an integer type): how the lengths of the edges
+ * are stored, and the type and infinity of the distances the searches add them into.
+ * Floating point weights keep the lengths as they are and add in their own type, integer weights
+ * keep them in fixed point and add in 64 bits
+ */
+template <class W, bool = std::is_integral<W>::value>
+struct WeightTraits
+{
+	typedef W Distance;
+
+	static W fromLength(double length) { return (W)length; }
+	static double toLength(Distance distance) { return distance; }
+	static Distance infinity() { return std::numeric_limits<Distance>::max(); }
+};
+
+template <class W>
+struct WeightTraits<W, true>
+{
+	typedef typename std::conditional<std::is_signed<W>::value, std::int64_t, std::uint64_t>::type Distance;
+
+	static W fromLength(double length) { return (W)std::llround(length * WEIGHT_SCALE); }
+	static double toLength(Distance distance) { return distance * (1.0 / WEIGHT_SCALE); }
+	static Distance infinity() { return std::numeric_limits<Distance>::max(); }
+};
+
+// unreachable, in the double distances and lengths used outside the graph
+#define INF WeightTraits<double>::infinity()
+
+/**
+ * Directedness of a graph: loadNodesAndEdges adds each edge of the map files in one direction
+ * (Directed) or in both (Undirected)
+ */
+struct Directed
+{
+	static const bool undirected = false;
+};
+
+struct Undirected
+{
+	static const bool undirected = true;
+};
+
+/************************* Compact storage  **************************/
+
+// Built with COMPACT_GRAPH defined (make compact), the graph stores coordinates, weights and edges
+// in smaller encodings, for maps much bigger than a city
+#ifdef COMPACT_GRAPH
+// 32-bit fixed point weights, each shorter than 2^32 / WEIGHT_SCALE units
+typedef std::uint32_t DefaultWeight;
+// relative to the first vertex of the map (Graph::originX, Graph::originY), so they keep 24 bits
+// of precision over the size of the map (under 4 cm over the whole of Portugal, in metres)
+typedef float Coordinate;
+#else
+typedef double DefaultWeight;
+typedef double Coordinate;
+#endif
+
+#ifdef COMPACT_GRAPH
+/*
+ * Small signed numbers as small unsigned numbers: 0, -1, 1, -2, 2... become 0, 1, 2, 3, 4...
+ */
+inline std::uint32_t zigzag(std::int32_t value)
+{
+	return ((std::uint32_t)value << 1) ^ (std::uint32_t)(value >> 31);
+}
+
+inline std::int32_t unzigzag(std::uint32_t value)
+{
+	return (std::int32_t)(value >> 1) ^ -(std::int32_t)(value & 1);
+}
+
+/*
+ * Bytes taken by a number in the varint encoding: 7 bits per byte, lowest first,
+ * with the high bit set on every byte but the last
+ */
+inline unsigned int varintSize(std::uint32_t value)
+{
+	unsigned int size = 1;
+	while (value >= 0x80)
+	{
+		value >>= 7;
+		size++;
+	}
+	return size;
+}
+
+template <class Bytes>
+void writeVarint(Bytes &bytes, std::uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		bytes.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back((unsigned char)value);
+}
+
+/*
+ * Varint at bytes[position], moving position past it
+ */
+inline std::uint32_t readVarint(const unsigned char *bytes, unsigned int &position)
+{
+	std::uint32_t value = bytes[position++];
+	if (value < 0x80)
+		return value;
+	value &= 0x7f;
+	for (unsigned int shift = 7;; shift += 7)
+	{
+		std::uint32_t byte = bytes[position++];
+		value |= (byte & 0x7f) << shift;
+		if (byte < 0x80)
+			return value;
+	}
+}
+#endif
+
+/************************* Coordinates  **************************/
+
+struct Coordinates
+{
+	Coordinate x, y;
+};
+
+/********************** Edge  ****************************/
+
+/**
+ * Outgoing edge of a vertex, an entry of the adjacency rows of the graph. The weight is kept by the
+ * graph (Graph::edgeWeights), so both directions of an undirected edge share it
+ */
+template <class T>
+class Edge
+{
+	unsigned int dest; // index of the destination vertex
+	unsigned int id;   // index of the edge weight
+public:
+	Edge(unsigned int d, unsigned int id);
+	unsigned int getDest() const;
+	unsigned int getId() const;
+	template <class, class, class>
+	friend class Graph;
+};
+
+template <class T>
+Edge<T>::Edge(unsigned int d, unsigned int id) : dest(d), id(id) {}
+
+template <class T>
+unsigned int Edge<T>::getDest() const
+{
+	return dest;
+}
+
+template <class T>
+unsigned int Edge<T>::getId() const
+{
+	return id;
+}
+
+/********************** Shortcut  ****************************/
+
+/**
+ * Edge of a contracted graph (Graph::contractChains) that replaces a chain of shape vertices,
+ * which have only the previous and the next vertex of the road as neighbours
+ */
+template <class D>
+struct Shortcut
+{
+	unsigned int dest;		  // index of the vertex at the end of the chain
+	D weight;				  // length of the whole chain
+	unsigned int first_shape; // shape vertices of the chain, in order, are shapes[first_shape, last_shape)
+	unsigned int last_shape;
+};
+
+/********************** ShortestPaths  ****************************/
+
+/**
+ * Result of a single-source shortest path search kept outside the vertices,
+ * so several searches can run on the same graph at the same time.
+ * Vertices are identified by their index in the vertex set. D is the distance type of the graph
+ * (Graph::Paths)
+ */
+template <class D = double>
+struct ShortestPaths
+{
+	std::vector<D> dist;	  // distance from the source, WeightTraits infinity if unreachable
+	std::vector<int> path;	  // index of the previous vertex, -1 for the source and unreachable vertices
+	std::vector<int> via;	  // shortcut taken from the previous vertex, -1 for an edge (empty if the search was not contracted)
+};
+
+/********************** IndexPriorityQueue  ****************************/
+
+/**
+ * Binary min-heap of vertex indices ordered by their distance in a ShortestPaths,
+ * with decrease key
+ */
+template <class K>
+class IndexPriorityQueue
+{
+	const std::vector<K> &keys;
+	std::vector<unsigned int> heap;
+	std::vector<int> position; // position of each index in the heap, -1 if not there
+
+	void heapifyUp(unsigned int i);
+	void heapifyDown(unsigned int i);
+	void set(unsigned int i, unsigned int index);
+
+public:
+	IndexPriorityQueue(const std::vector<K> &keys);
+	bool empty() const;
+	void insert(unsigned int index);
+	unsigned int extractMin();
+	void decreaseKey(unsigned int index);
+};
+
+template <class K>
+IndexPriorityQueue<K>::IndexPriorityQueue(const std::vector<K> &keys) : keys(keys), position(keys.size(), -1) {}
+
+template <class K>
+bool IndexPriorityQueue<K>::empty() const
+{
+	return heap.empty();
+}
+
+template <class K>
+void IndexPriorityQueue<K>::set(unsigned int i, unsigned int index)
+{
+	heap[i] = index;
+	position[index] = i;
+}
+
+template <class K>
+void IndexPriorityQueue<K>::heapifyUp(unsigned int i)
+{
+	unsigned int index = heap[i];
+	while (i > 0 && keys[index] < keys[heap[(i - 1) / 2]])
+	{
+		set(i, heap[(i - 1) / 2]);
+		i = (i - 1) / 2;
+	}
+	set(i, index);
+}
+
+template <class K>
+void IndexPriorityQueue<K>::heapifyDown(unsigned int i)
+{
+	unsigned int index = heap[i];
+	while (true)
+	{
+		unsigned int child = 2 * i + 1;
+		if (child >= heap.size())
+			break;
+		if (child + 1 < heap.size() && keys[heap[child + 1]] < keys[heap[child]])
+			child++;
+		if (!(keys[heap[child]] < keys[index]))
+			break;
+		set(i, heap[child]);
+		i = child;
+	}
+	set(i, index);
+}
+
+template <class K>
+void IndexPriorityQueue<K>::insert(unsigned int index)
+{
+	heap.push_back(index);
+	heapifyUp(heap.size() - 1);
+}
+
+template <class K>
+unsigned int IndexPriorityQueue<K>::extractMin()
+{
+	unsigned int min = heap[0];
+	position[min] = -1;
+	unsigned int last = heap.back();
+	heap.pop_back();
+	if (!heap.empty())
+	{
+		set(0, last);
+		heapifyDown(0);
+	}
+	return min;
+}
+
+template <class K>
+void IndexPriorityQueue<K>::decreaseKey(unsigned int index)
+{
+	heapifyUp(position[index]);
+}
+
+/*************************** LoadOptions  **************************/
+
+enum ComponentFilter
+{
+	ALL_COMPONENTS,	   // keep the whole map
+	LARGEST_COMPONENT, // keep only the largest strongly connected component
+	GARAGE_COMPONENT   // keep only the component of the garage, once it is picked (Graph::keepComponent)
+};
+
+enum VertexOrder
+{
+	FILE_ORDER,	   // as listed in the nodes file
+	HILBERT_ORDER, // along a Hilbert curve over the coordinates
+	BFS_ORDER	   // breadth-first, from low degree vertices and to lower degree neighbours first (Cuthill-McKee)
+};
+
+struct LoadOptions
+{
+	ComponentFilter components = ALL_COMPONENTS;
+	VertexOrder order = FILE_ORDER;
+};
+
+/**
+ * Position of a point of a 2^16 x 2^16 grid along a Hilbert curve that covers it
+ */
+inline std::uint64_t hilbertIndex(std::uint32_t x, std::uint32_t y)
+{
+	std::uint64_t d = 0;
+	for (std::uint32_t s = 1u << 15; s > 0; s >>= 1)
+	{
+		std::uint32_t rx = (x & s) > 0;
+		std::uint32_t ry = (y & s) > 0;
+		d += (std::uint64_t)s * s * ((3 * rx) ^ ry);
+		// rotate the quadrant so the curve inside it starts and ends next to the neighbouring quadrants
+		if (ry == 0)
+		{
+			if (rx == 1)
+			{
+				x = s - 1 - (x & (s - 1));
+				y = s - 1 - (y & (s - 1));
+			}
+			std::swap(x, y);
+		}
+		x &= s - 1;
+		y &= s - 1;
+	}
+	return d;
+}
+
+/*************************** Graph  **************************/
+
+/**
+ * Graph stored as a structure of arrays: vertices are identified by their index, and their contents,
+ * coordinates and outgoing edges are kept in separate dense arrays, so each algorithm reads only
+ * the arrays it needs. The outgoing edges are in compressed sparse rows (one array for all of them,
+ * the edges of each vertex next to each other).
+ * The arrays of a map take their memory from an arena, sized from the map files and freed at once
+ * when another map is loaded or the graph is destroyed. The arena does not reuse memory given back,
+ * so the arrays never grow in place: adding past their reserve moves them all to a new arena (makeRoom).
+ * The index of the vertices by content, whose entries are erased, keeps the standard allocator.
+ * Built with COMPACT_GRAPH, coordinates are floats, weights are fixed point, and each edge is encoded
+ * in two varints: its target minus its source, and its weight id relative to the ids first used
+ * by its source or by its target (encodeAdjacency). Once the vertices are reordered, most edges take
+ * 2 or 3 bytes instead of 8. The searches decode the edges as they go (readEdge). Vertices are found
+ * by binary search in an array of indices sorted by content, instead of a hash map.
+ * The policies are template parameters, fixed at compile time: T is the type of the vertex contents (ids),
+ * W the type of the edge weights (WeightTraits: double for exact distances, float or an integer type
+ * for smaller arrays) and Direction whether the edges of the map files are Directed or Undirected
+ */
+template <class T, class W = DefaultWeight, class Direction = Undirected>
+class Graph
+{
+public:
+	typedef WeightTraits<W> Weights;
+	typedef typename Weights::Distance Distance; // of the searches
+	typedef ShortestPaths<Distance> Paths;
+
+private:
+	typedef std::unordered_map<T, unsigned int> IndexMap;
+
+	Arena arena; // memory of the arrays below, but the index map
+	ArenaVector<T> vertexSet;				  // content of each vertex, by index
+	ArenaVector<Coordinates> coordinates;	  // x and y of each vertex, by index
+#ifdef COMPACT_GRAPH
+	ArenaVector<unsigned int> sortedIndices; // indices of the vertices sorted by content, searched by findVertexIndex
+#else
+	IndexMap vertexIndex; // index of each vertex, by content
+#endif
+	ArenaVector<unsigned int> edgeOffsets; // outgoing edges of vertex i are adjacency[edgeOffsets[i], edgeOffsets[i + 1])
+#ifdef COMPACT_GRAPH
+	double originX = 0, originY = 0;		// coordinates of the first vertex, the others are relative to it
+	ArenaVector<unsigned char> adjacency;	// encoded edges, edgeOffsets are in bytes
+	ArenaVector<unsigned int> firstEdgeId; // ids first used by vertex i are [firstEdgeId[i], firstEdgeId[i + 1])
+	unsigned int numEdges = 0;
+#else
+	ArenaVector<Edge<T>> adjacency;
+#endif
+	ArenaVector<W> edgeWeights; // weight of each edge, by id; an undirected edge has one weight for both directions
+	std::uint64_t checksum = 0;		// of the map files, the load options and the component kept, 0 if the graph was not loaded from files
+
+	// strongly connected components (updateComponents), valid until the graph changes
+	ArenaVector<int> component;					// component of each vertex, by index
+	std::vector<unsigned int> componentSizes; // number of vertices of each component
+	bool componentsValid = false;
+
+	// weakly connected components, as a union-find forest kept up to date as edges are added
+	ArenaVector<unsigned int> connectedParent; // parent of each vertex in the forest, by index
+	ArenaVector<unsigned int> connectedSize;	// number of vertices below each root
+
+	// chains of shape vertices contracted into shortcuts (contractChains), empty if the graph is not contracted
+	std::vector<bool> core;						// vertices kept by the contraction, by index
+	std::vector<unsigned int> shortcutOffsets; // shortcuts of vertex i are shortcutSet[shortcutOffsets[i], shortcutOffsets[i + 1])
+	std::vector<Shortcut<Distance>> shortcutSet;
+	std::vector<unsigned int> shapes; // shape vertices of all shortcuts
+	unsigned int numCoreVertices = 0;
+
+	Paths lastPaths; // of the last dijkstraShortestPath(origin)
+
+	unsigned int findConnected(unsigned int index);
+	void uniteConnected(unsigned int a, unsigned int b);
+	void resetConnected();
+	unsigned int insertEdge(unsigned int source, unsigned int dest, unsigned int id);
+	void buildAdjacency(const std::vector<unsigned int> &sources, const std::vector<Edge<T>> &edges);
+#ifdef COMPACT_GRAPH
+	void encodeAdjacency(std::vector<Edge<T>> &rows);
+#endif
+	Edge<T> readEdge(unsigned int source, unsigned int &position) const;
+	double getDistance(unsigned int a, unsigned int b) const;
+	void reserve(unsigned int number_of_vertices, unsigned int number_of_edges, unsigned int number_of_weights);
+	void reserveArrays(std::size_t vertices, std::size_t entries, std::size_t weights);
+	void makeRoom(std::size_t more_vertices, std::size_t more_entries, std::size_t more_weights);
+	void releaseArrays();
+	std::size_t getIndexMemory() const;
+	template <class U>
+	static void refill(ArenaVector<U> &array, const std::vector<U> &copy, std::size_t capacity);
+
+public:
+	Graph();
+	Graph(const Graph &) = delete;
+	Graph &operator=(const Graph &) = delete;
+	void clear();
+	std::size_t getMemoryUsed() const;
+	std::size_t getMemoryReserved() const;
+	int findVertexIndex(const T &in) const;
+	bool addVertex(const T &in, double x, double y);
+	bool addEdge(const T &sourc, const T &dest);
+	bool addUndirectedEdge(const T &a, const T &b);
+	int getNumVertex() const;
+	bool isUndirected() const;
+	std::uint64_t getChecksum() const;
+	const ArenaVector<T> &getVertexSet() const;
+	double getX(unsigned int index) const;
+	double getY(unsigned int index) const;
+	unsigned int getOutDegree(unsigned int index) const;
+	std::vector<Edge<T>> getEdgesOut(unsigned int index) const;
+	double getWeight(const Edge<T> &edge) const;
+
+	void dijkstraShortestPath(const T &s);
+	void dijkstraShortestPath(unsigned int origin_index, Paths &paths) const;
+	void dijkstraShortestPath(unsigned int origin_index, Paths &paths, const std::vector<unsigned int> &targets) const;
+	double getPathLength(unsigned int dest_index, const Paths &paths) const;
+	vector<T> getPathTo(const T &dest) const;
+	void getPathTo(const T &dest, vector<T> &path) const;
+	vector<T> getPathTo(unsigned int dest_index, const Paths &paths) const;
+	void getPathTo(unsigned int dest_index, const Paths &paths, vector<T> &path) const;
+
+	bool isConnected(T origin) const;
+	void updateComponents();
+	unsigned int getNumComponents() const;
+	int getComponent(const T &in) const;
+	unsigned int getComponentSize(int component) const;
+	bool areStronglyConnected(const T &a, const T &b) const;
+	bool areConnected(const T &a, const T &b) const;
+	int getLargestComponent() const;
+	void keepComponent(int component);
+	int getNumEdges() const;
+	unsigned int getNumEdgeWeights() const;
+	void renumberEdges();
+	void reorderVertices(VertexOrder order);
+	void reorderVertices(const std::vector<unsigned int> &order);
+
+	void contractChains(const std::vector<T> &kept);
+	void clearContraction();
+	bool isContracted() const;
+	bool isCoreVertex(const T &in) const;
+	unsigned int getNumCoreVertices() const;
+	unsigned int getNumShortcuts() const;
+
+	void loadNodesAndEdges(string city_name, LoadOptions options = LoadOptions());
+	void drawGraph(GraphViewer *gv);
+};
+
+template <class T, class W, class Direction>
+Graph<T, W, Direction>::Graph()
+	: vertexSet(&arena), coordinates(&arena),
+#ifdef COMPACT_GRAPH
+	  sortedIndices(&arena),
+#endif
+	  edgeOffsets(1, 0, &arena), adjacency(&arena),
+#ifdef COMPACT_GRAPH
+	  firstEdgeId(&arena),
+#endif
+	  edgeWeights(&arena), component(&arena), connectedParent(&arena), connectedSize(&arena) {}
+
+/**
+ * Removes all vertices and edges and frees the memory of the map at once
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::clear()
+{
+	releaseArrays();
+#ifdef COMPACT_GRAPH
+	numEdges = 0;
+#else
+	IndexMap().swap(vertexIndex);
+#endif
+
+	edgeOffsets.push_back(0);
+	checksum = 0;
+	componentSizes.clear();
+	componentsValid = false;
+	clearContraction();
+	lastPaths = Paths();
+}
+
+/**
+ * Empties the arrays and frees the memory of the arena
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::releaseArrays()
+{
+	// the arrays must let go of the arena memory before it is freed
+	ArenaVector<T>(&arena).swap(vertexSet);
+	ArenaVector<Coordinates>(&arena).swap(coordinates);
+#ifdef COMPACT_GRAPH
+	ArenaVector<unsigned int>(&arena).swap(sortedIndices);
+#endif
+	ArenaVector<unsigned int>(&arena).swap(edgeOffsets);
+#ifdef COMPACT_GRAPH
+	ArenaVector<unsigned char>(&arena).swap(adjacency);
+	ArenaVector<unsigned int>(&arena).swap(firstEdgeId);
+#else
+	ArenaVector<Edge<T>>(&arena).swap(adjacency);
+#endif
+	ArenaVector<W>(&arena).swap(edgeWeights);
+	ArenaVector<int>(&arena).swap(component);
+	ArenaVector<unsigned int>(&arena).swap(connectedParent);
+	ArenaVector<unsigned int>(&arena).swap(connectedSize);
+	arena.clear();
+}
+
+/**
+ * Makes room in the arena for more vertices, edges (in both directions for undirected edges) and edge weights,
+ * so adding them allocates no more memory
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::reserve(unsigned int number_of_vertices, unsigned int number_of_edges, unsigned int number_of_weights)
+{
+#ifdef COMPACT_GRAPH
+	// the encoded size is only known once the edges are sorted, most edges take 2 or 3 bytes
+	std::size_t entries = adjacency.size() + 3 * (std::size_t)number_of_edges;
+#else
+	std::size_t entries = adjacency.size() + number_of_edges;
+	vertexIndex.reserve(vertexSet.size() + number_of_vertices);
+#endif
+	reserveArrays(vertexSet.size() + number_of_vertices, entries, edgeWeights.size() + number_of_weights);
+}
+
+/**
+ * Reserves the arrays for the given numbers of vertices, adjacency entries (bytes with COMPACT_GRAPH)
+ * and edge weights. An array that already has memory can not grow in the arena without leaving its old
+ * memory behind until clear, so then all the arrays are copied to a new arena instead.
+ * The arrays of the vertices are always reserved together, vertexSet and edgeOffsets stand for them
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::reserveArrays(std::size_t vertices, std::size_t entries, std::size_t weights)
+{
+#ifdef COMPACT_GRAPH
+	unsigned int vertex_arrays = 6;
+#else
+	unsigned int vertex_arrays = 4;
+#endif
+	std::size_t vertex_bytes = sizeof(T) + sizeof(Coordinates) + vertex_arrays * sizeof(unsigned int);
+	std::size_t entry_bytes = sizeof(typename decltype(adjacency)::value_type);
+	auto grows = [](std::size_t capacity, std::size_t size) { return capacity > 0 && capacity < size; };
+	bool move = grows(vertexSet.capacity(), vertices) || grows(edgeOffsets.capacity(), vertices + 1) ||
+				grows(adjacency.capacity(), entries) || grows(edgeWeights.capacity(), weights);
+
+	if (!move)
+	{
+		// only empty arrays are reserved, in one block
+		arena.reserve((vertexSet.capacity() < vertices ? vertices * vertex_bytes : 0) +
+					  (adjacency.capacity() < entries ? entries * entry_bytes : 0) +
+					  (edgeWeights.capacity() < weights ? weights * sizeof(W) : 0) + 4096);
+		vertexSet.reserve(vertices);
+		coordinates.reserve(vertices);
+#ifdef COMPACT_GRAPH
+		sortedIndices.reserve(vertices);
+		firstEdgeId.reserve(vertices + 1);
+#endif
+		edgeOffsets.reserve(vertices + 1);
+		connectedParent.reserve(vertices);
+		connectedSize.reserve(vertices);
+		component.reserve(vertices);
+		adjacency.reserve(entries);
+		edgeWeights.reserve(weights);
+		return;
+	}
+
+	std::vector<T> vertex_set(vertexSet.begin(), vertexSet.end());
+	std::vector<Coordinates> vertex_coordinates(coordinates.begin(), coordinates.end());
+#ifdef COMPACT_GRAPH
+	std::vector<unsigned int> sorted_indices(sortedIndices.begin(), sortedIndices.end());
+	std::vector<unsigned int> first_edge_id(firstEdgeId.begin(), firstEdgeId.end());
+#endif
+	std::vector<unsigned int> edge_offsets(edgeOffsets.begin(), edgeOffsets.end());
+	std::vector<typename decltype(adjacency)::value_type> edges(adjacency.begin(), adjacency.end());
+	std::vector<W> weights_copy(edgeWeights.begin(), edgeWeights.end());
+	std::vector<int> components(component.begin(), component.end());
+	std::vector<unsigned int> parents(connectedParent.begin(), connectedParent.end());
+	std::vector<unsigned int> sizes(connectedSize.begin(), connectedSize.end());
+
+	releaseArrays();
+	arena.reserve(vertices * vertex_bytes + entries * entry_bytes + weights * sizeof(W) + 4096);
+	refill(vertexSet, vertex_set, vertices);
+	refill(coordinates, vertex_coordinates, vertices);
+#ifdef COMPACT_GRAPH
+	refill(sortedIndices, sorted_indices, vertices);
+	refill(firstEdgeId, first_edge_id, vertices + 1);
+#endif
+	refill(edgeOffsets, edge_offsets, vertices + 1);
+	refill(connectedParent, parents, vertices);
+	refill(connectedSize, sizes, vertices);
+	refill(component, components, vertices);
+	refill(adjacency, edges, entries);
+	refill(edgeWeights, weights_copy, weights);
+}
+
+template <class T, class W, class Direction>
+template <class U>
+void Graph<T, W, Direction>::refill(ArenaVector<U> &array, const std::vector<U> &copy, std::size_t capacity)
+{
+	array.reserve(std::max(capacity, copy.size()));
+	array.assign(copy.begin(), copy.end());
+}
+
+/**
+ * Makes room for adding to the arrays one by one, doubling them when they are full,
+ * so the copies to a new arena take amortized constant time
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::makeRoom(std::size_t more_vertices, std::size_t more_entries, std::size_t more_weights)
+{
+	std::size_t vertices = vertexSet.size() + more_vertices;
+	std::size_t entries = adjacency.size() + more_entries;
+	std::size_t weights = edgeWeights.size() + more_weights;
+	if (vertices <= vertexSet.capacity() && vertices + 1 <= edgeOffsets.capacity() &&
+		entries <= adjacency.capacity() && weights <= edgeWeights.capacity())
+		return;
+	auto grown = [](std::size_t size, std::size_t capacity) { return size <= capacity ? capacity : std::max(size, 2 * capacity); };
+	reserveArrays(grown(vertices + 1, edgeOffsets.capacity()) - 1, grown(entries, adjacency.capacity()),
+				  grown(weights, edgeWeights.capacity()));
+}
+
+/**
+ * Bytes of the arrays of the map and of its index
+ */
+template <class T, class W, class Direction>
+std::size_t Graph<T, W, Direction>::getMemoryUsed() const
+{
+	return arena.getBytesUsed() + getIndexMemory();
+}
+
+/**
+ * Bytes taken from the system for the map
+ */
+template <class T, class W, class Direction>
+std::size_t Graph<T, W, Direction>::getMemoryReserved() const
+{
+	return arena.getBytesReserved() + getIndexMemory();
+}
+
+/**
+ * Bytes of the index map, outside the arena: a node (value and next pointer) per vertex and a pointer per bucket
+ */
+template <class T, class W, class Direction>
+std::size_t Graph<T, W, Direction>::getIndexMemory() const
+{
+#ifdef COMPACT_GRAPH
+	return 0;
+#else
+	return vertexIndex.size() * (sizeof(typename IndexMap::value_type) + sizeof(void *)) + vertexIndex.bucket_count() * sizeof(void *);
+#endif
+}
+
+template <class T, class W, class Direction>
+int Graph<T, W, Direction>::getNumVertex() const
+{
+	return vertexSet.size();
+}
+
+template <class T, class W, class Direction>
+bool Graph<T, W, Direction>::isUndirected() const
+{
+	return Direction::undirected;
+}
+
+template <class T, class W, class Direction>
+std::uint64_t Graph<T, W, Direction>::getChecksum() const
+{
+	return checksum;
+}
+
+/**
+ * Contents of the vertices, by index
+ */
+template <class T, class W, class Direction>
+const ArenaVector<T> &Graph<T, W, Direction>::getVertexSet() const
+{
+	return vertexSet;
+}
+
+template <class T, class W, class Direction>
+double Graph<T, W, Direction>::getX(unsigned int index) const
+{
+#ifdef COMPACT_GRAPH
+	return originX + coordinates[index].x;
+#else
+	return coordinates[index].x;
+#endif
+}
+
+template <class T, class W, class Direction>
+double Graph<T, W, Direction>::getY(unsigned int index) const
+{
+#ifdef COMPACT_GRAPH
+	return originY + coordinates[index].y;
+#else
+	return coordinates[index].y;
+#endif
+}
+
+template <class T, class W, class Direction>
+unsigned int Graph<T, W, Direction>::getOutDegree(unsigned int index) const
+{
+#ifdef COMPACT_GRAPH
+	unsigned int degree = 0;
+	for (unsigned int e = edgeOffsets[index]; e < edgeOffsets[index + 1]; degree++)
+		readEdge(index, e);
+	return degree;
+#else
+	return edgeOffsets[index + 1] - edgeOffsets[index];
+#endif
+}
+
+/**
+ * Outgoing edges of a vertex, decoded
+ */
+template <class T, class W, class Direction>
+std::vector<Edge<T>> Graph<T, W, Direction>::getEdgesOut(unsigned int index) const
+{
+	std::vector<Edge<T>> edges;
+	for (unsigned int e = edgeOffsets[index]; e < edgeOffsets[index + 1];)
+		edges.push_back(readEdge(index, e));
+	return edges;
+}
+
+template <class T, class W, class Direction>
+double Graph<T, W, Direction>::getWeight(const Edge<T> &edge) const
+{
+	return Weights::toLength(edgeWeights[edge.id]);
+}
+
+/**
+ * Outgoing edge of a vertex at a position of its adjacency row, moving the position to the next edge
+ */
+template <class T, class W, class Direction>
+inline Edge<T> Graph<T, W, Direction>::readEdge(unsigned int source, unsigned int &position) const
+{
+#ifdef COMPACT_GRAPH
+	unsigned int dest = source + unzigzag(readVarint(adjacency.data(), position));
+	std::uint32_t id = readVarint(adjacency.data(), position);
+	// the lowest bit tells whether the id is one of those first used by the target instead of the source
+	return Edge<T>(dest, firstEdgeId[id & 1 ? dest : source] + (id >> 1));
+#else
+	return adjacency[position++];
+#endif
+}
+
+/**
+ * Straight line distance between two vertices, the weight of the edges between them
+ */
+template <class T, class W, class Direction>
+double Graph<T, W, Direction>::getDistance(unsigned int a, unsigned int b) const
+{
+	double dx = (double)coordinates[a].x - coordinates[b].x, dy = (double)coordinates[a].y - coordinates[b].y;
+	return sqrt(pow(dx, 2) + pow(dy, 2));
+}
+
+/*
+ * Index in the vertex set of the vertex with a given content, -1 if there is none.
+ */
+template <class T, class W, class Direction>
+int Graph<T, W, Direction>::findVertexIndex(const T &in) const
+{
+#ifdef COMPACT_GRAPH
+	auto it = std::lower_bound(sortedIndices.begin(), sortedIndices.end(), in,
+							   [this](unsigned int index, const T &value) { return vertexSet[index] < value; });
+	return it == sortedIndices.end() || !(vertexSet[*it] == in) ? -1 : *it;
+#else
+	auto it = vertexIndex.find(in);
+	return it == vertexIndex.end() ? -1 : it->second;
+#endif
+}
+
+/*
+ *  Adds a vertex with a given content or info (in) to a graph (this).
+ *  Returns true if successful, and false if a vertex with that content already exists.
+ *  Constant time, except with COMPACT_GRAPH: the sorted indices take a linear insertion
+ *  unless the contents come in increasing order, as in the map files
+ */
+template <class T, class W, class Direction>
+bool Graph<T, W, Direction>::addVertex(const T &in, double x, double y)
+{
+#ifdef COMPACT_GRAPH
+	// linear when the contents do not come in increasing order, the map files are nearly sorted
+	auto it = std::lower_bound(sortedIndices.begin(), sortedIndices.end(), in,
+							   [this](unsigned int index, const T &value) { return vertexSet[index] < value; });
+	if (it != sortedIndices.end() && vertexSet[*it] == in)
+		return false;
+	unsigned int position = it - sortedIndices.begin();
+	makeRoom(1, 0, 0);
+	sortedIndices.insert(sortedIndices.begin() + position, vertexSet.size());
+#else
+	if (findVertexIndex(in) != -1)
+		return false;
+	makeRoom(1, 0, 0);
+	vertexIndex[in] = vertexSet.size();
+#endif
+	connectedParent.push_back(vertexSet.size());
+	connectedSize.push_back(1);
+	vertexSet.push_back(in);
+#ifdef COMPACT_GRAPH
+	if (vertexSet.size() == 1)
+	{
+		originX = x;
+		originY = y;
+	}
+	coordinates.push_back({(Coordinate)(x - originX), (Coordinate)(y - originY)});
+	firstEdgeId.resize(vertexSet.size() + 1, edgeWeights.size());
+#else
+	coordinates.push_back({x, y});
+#endif
+	edgeOffsets.push_back(adjacency.size());
+	componentsValid = false;
+	clearContraction();
+	return true;
+}
+
+/*
+ * Adds an edge to a graph (this), given the contents of the source and destination vertices.
+ * The weight is the distance between them.
+ * Returns true if successful, and false if the source or destination vertex does not exist.
+ * Inserting in the adjacency rows takes linear time (insertEdge), whole maps are loaded at once
+ * with buildAdjacency (loadNodesAndEdges)
+ */
+template <class T, class W, class Direction>
+bool Graph<T, W, Direction>::addEdge(const T &sourc, const T &dest)
+{
+	int v1 = findVertexIndex(sourc);
+	int v2 = findVertexIndex(dest);
+	if (v1 == -1 || v2 == -1)
+		return false;
+	makeRoom(0, 0, 1);
+	edgeWeights.push_back(Weights::fromLength(getDistance(v1, v2)));
+	insertEdge(v1, v2, edgeWeights.size() - 1);
+	return true;
+}
+
+/*
+ * Adds an edge in both directions between two vertices, given their contents.
+ * The weight is computed and stored once, and shared by both directions.
+ * Returns true if successful, and false if one of the vertices does not exist.
+ * Linear time, as addEdge
+ */
+template <class T, class W, class Direction>
+bool Graph<T, W, Direction>::addUndirectedEdge(const T &a, const T &b)
+{
+	int v1 = findVertexIndex(a);
+	int v2 = findVertexIndex(b);
+	if (v1 == -1 || v2 == -1)
+		return false;
+	makeRoom(0, 0, 1);
+	edgeWeights.push_back(Weights::fromLength(getDistance(v1, v2)));
+	unsigned int id = insertEdge(v2, v1, edgeWeights.size() - 1);
+	insertEdge(v1, v2, id);
+	return true;
+}
+
+/**
+ * Adds an edge at the end of the adjacency row of its source, moving the rows after it:
+ * linear in the number of edges and vertices, with a single move of memory.
+ * Returns the id of its weight, which the compact encoding renumbers
+ */
+template <class T, class W, class Direction>
+unsigned int Graph<T, W, Direction>::insertEdge(unsigned int source, unsigned int dest, unsigned int id)
+{
+#ifdef COMPACT_GRAPH
+	unsigned int n = vertexSet.size();
+	if (id >= firstEdgeId[n])
+	{
+		// a new weight becomes the last id first used by the source: the ids of the vertices after it move
+		// up by one together with their firstEdgeId, so no encoded edge changes
+		W weight = edgeWeights[id];
+		edgeWeights.erase(edgeWeights.begin() + id);
+		id = firstEdgeId[source + 1];
+		edgeWeights.insert(edgeWeights.begin() + id, weight);
+		for (unsigned int v = source + 1; v <= n; v++)
+			firstEdgeId[v]++;
+	}
+	// otherwise the weight is shared with the other direction of the edge, one of those first used by the target
+
+	std::vector<unsigned char> bytes;
+	bool by_source = id >= firstEdgeId[source] && id < firstEdgeId[source + 1];
+	writeVarint(bytes, zigzag((std::int32_t)(dest - source)));
+	writeVarint(bytes, (id - firstEdgeId[by_source ? source : dest]) << 1 | (by_source ? 0 : 1));
+	makeRoom(0, bytes.size(), 0);
+	adjacency.insert(adjacency.begin() + edgeOffsets[source + 1], bytes.begin(), bytes.end());
+	for (unsigned int i = source + 1; i <= n; i++)
+		edgeOffsets[i] += bytes.size();
+	numEdges++;
+#else
+	makeRoom(0, 1, 0);
+	adjacency.insert(adjacency.begin() + edgeOffsets[source + 1], Edge<T>(dest, id));
+	for (unsigned int i = source + 1; i < edgeOffsets.size(); i++)
+		edgeOffsets[i]++;
+#endif
+	uniteConnected(source, dest);
+	componentsValid = false;
+	clearContraction();
+	return id;
+}
+
+/**
+ * Replaces all edges with the given ones (the edge from sources[i] is edges[i]), building the
+ * adjacency rows with one counting sort. Edges keep their order within each row
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::buildAdjacency(const std::vector<unsigned int> &sources, const std::vector<Edge<T>> &edges)
+{
+	// edgeOffsets[i] counts up to the end of row i, then edges are placed backwards from there
+	unsigned int n = vertexSet.size();
+	edgeOffsets.assign(n + 1, 0);
+	for (unsigned int source : sources)
+		edgeOffsets[source]++;
+	for (unsigned int i = 1; i <= n; i++)
+		edgeOffsets[i] += edgeOffsets[i - 1];
+
+#ifdef COMPACT_GRAPH
+	std::vector<Edge<T>> rows(edges.size(), Edge<T>(0, 0));
+	for (unsigned int e = edges.size(); e-- > 0;)
+		rows[--edgeOffsets[sources[e]]] = edges[e];
+	encodeAdjacency(rows);
+#else
+	adjacency.clear();
+	if (edges.size() > adjacency.capacity())
+		reserveArrays(vertexSet.capacity(), edges.size(), edgeWeights.capacity());
+	adjacency.assign(edges.size(), Edge<T>(0, 0));
+	for (unsigned int e = edges.size(); e-- > 0;)
+		adjacency[--edgeOffsets[sources[e]]] = edges[e];
+#endif
+
+	componentsValid = false;
+	clearContraction();
+}
+
+#ifdef COMPACT_GRAPH
+/**
+ * Compact encoding of the adjacency rows, given decoded (rows[edgeOffsets[i], edgeOffsets[i + 1]) are
+ * the edges of vertex i). The ids are first renumbered in the order they are first used, dropping unused
+ * weights, so the ids first used by each vertex are consecutive and each edge can store its id relative
+ * to those of its source or of its target (an id may only be shared by the two directions of an edge).
+ * edgeOffsets become offsets in bytes
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::encodeAdjacency(std::vector<Edge<T>> &rows)
+{
+	unsigned int n = vertexSet.size();
+	const unsigned int NONE = std::numeric_limits<unsigned int>::max();
+	std::vector<unsigned int> new_id(edgeWeights.size(), NONE);
+	std::vector<W> weights;
+	weights.reserve(edgeWeights.size());
+	firstEdgeId.assign(n + 1, 0);
+	for (unsigned int v = 0; v < n; v++)
+	{
+		firstEdgeId[v] = weights.size();
+		for (unsigned int e = edgeOffsets[v]; e < edgeOffsets[v + 1]; e++)
+		{
+			if (new_id[rows[e].id] == NONE)
+			{
+				new_id[rows[e].id] = weights.size();
+				weights.push_back(edgeWeights[rows[e].id]);
+			}
+			rows[e].id = new_id[rows[e].id];
+		}
+	}
+	firstEdgeId[n] = weights.size();
+	edgeWeights.assign(weights.begin(), weights.end());
+
+	auto target = [](unsigned int source, const Edge<T> &edge) { return zigzag((std::int32_t)(edge.dest - source)); };
+	auto relativeId = [this](unsigned int source, const Edge<T> &edge) {
+		bool by_source = edge.id >= firstEdgeId[source] && edge.id < firstEdgeId[source + 1];
+		return (edge.id - firstEdgeId[by_source ? source : edge.dest]) << 1 | (by_source ? 0 : 1);
+	};
+
+	// sized first, so the bytes take only the memory they need
+	std::size_t size = 0;
+	for (unsigned int v = 0; v < n; v++)
+		for (unsigned int e = edgeOffsets[v]; e < edgeOffsets[v + 1]; e++)
+			size += varintSize(target(v, rows[e])) + varintSize(relativeId(v, rows[e]));
+	adjacency.clear();
+	if (size > adjacency.capacity())
+		reserveArrays(vertexSet.capacity(), size, edgeWeights.capacity());
+	for (unsigned int v = 0, begin = 0; v < n; v++)
+	{
+		unsigned int end = edgeOffsets[v + 1];
+		edgeOffsets[v] = adjacency.size();
+		for (unsigned int e = begin; e < end; e++)
+		{
+			writeVarint(adjacency, target(v, rows[e]));
+			writeVarint(adjacency, relativeId(v, rows[e]));
+		}
+		begin = end;
+	}
+	edgeOffsets[n] = adjacency.size();
+	numEdges = rows.size();
+}
+#endif
+
+/**
+ * Root of the union-find tree of a vertex (by index), compressing the path to it
+ */
+template <class T, class W, class Direction>
+unsigned int Graph<T, W, Direction>::findConnected(unsigned int index)
+{
+	unsigned int root = index;
+	while (connectedParent[root] != root)
+		root = connectedParent[root];
+	while (connectedParent[index] != root)
+	{
+		unsigned int next = connectedParent[index];
+		connectedParent[index] = root;
+		index = next;
+	}
+	return root;
+}
+
+/**
+ * Joins the weakly connected components of two vertices (by index), the smaller tree below the bigger one
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::uniteConnected(unsigned int a, unsigned int b)
+{
+	a = findConnected(a);
+	b = findConnected(b);
+	if (a == b)
+		return;
+	if (connectedSize[a] < connectedSize[b])
+		std::swap(a, b);
+	connectedParent[b] = a;
+	connectedSize[a] += connectedSize[b];
+}
+
+/**
+ * Rebuilds the union-find forest from the edges, with every path compressed
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::resetConnected()
+{
+	unsigned int n = vertexSet.size();
+	connectedParent.resize(n);
+	connectedSize.assign(n, 1);
+	for (unsigned int i = 0; i < n; i++)
+		connectedParent[i] = i;
+	for (unsigned int v = 0; v < n; v++)
+	{
+		for (unsigned int e = edgeOffsets[v]; e < edgeOffsets[v + 1];)
+			uniteConnected(v, readEdge(v, e).dest);
+	}
+	for (unsigned int i = 0; i < n; i++)
+		findConnected(i);
+}
+
+/**
+ * Checks if there is a path between two vertices ignoring the direction of the edges, without any search.
+ * Needs no update after adding edges; the paths of the forest are compressed after loading a map,
+ * so the check is almost constant time. Does not change the graph, so it can run in parallel
+ */
+template <class T, class W, class Direction>
+bool Graph<T, W, Direction>::areConnected(const T &a, const T &b) const
+{
+	int index_a = findVertexIndex(a), index_b = findVertexIndex(b);
+	if (index_a == -1 || index_b == -1)
+		return false;
+	unsigned int root_a = index_a, root_b = index_b;
+	while (connectedParent[root_a] != root_a)
+		root_a = connectedParent[root_a];
+	while (connectedParent[root_b] != root_b)
+		root_b = connectedParent[root_b];
+	return root_a == root_b;
+}
+
+/**
+ * Dijkstra algorithm. The paths are kept by the graph until the next search (getPathTo(dest))
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::dijkstraShortestPath(const T &origin)
+{
+	int origin_index = findVertexIndex(origin);
+	if (origin_index == -1)
+		return;
+	dijkstraShortestPath(origin_index, lastPaths);
+}
+
+/**
+ * Dijkstra algorithm over vertex indices, keeping the search state in paths instead of the graph.
+ * Only reads the graph, so it can run from several threads at once
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::dijkstraShortestPath(unsigned int origin_index, Paths &paths) const
+{
+	dijkstraShortestPath(origin_index, paths, std::vector<unsigned int>());
+}
+
+/**
+ * Same as above, but stops as soon as the shortest paths to all the target vertices are known
+ * (all vertices if there are no targets). The distances of other vertices may not be final then.
+ * If the graph is contracted and the origin and targets were kept, the search runs on the shortcuts:
+ * shape vertices are not reached, but getPathTo unpacks them
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::dijkstraShortestPath(unsigned int origin_index, Paths &paths, const std::vector<unsigned int> &targets) const
+{
+	paths.dist.assign(vertexSet.size(), Weights::infinity());
+	paths.path.assign(vertexSet.size(), -1);
+	paths.via.clear();
+	paths.dist[origin_index] = 0;
+
+	bool contracted = isContracted() && !targets.empty() && core[origin_index];
+	for (unsigned int t : targets)
+		contracted = contracted && core[t];
+	if (contracted)
+		paths.via.assign(vertexSet.size(), -1);
+
+	std::vector<bool> target(targets.empty() ? 0 : vertexSet.size(), false);
+	unsigned int targets_left = 0;
+	for (unsigned int t : targets)
+	{
+		if (!target[t])
+		{
+			target[t] = true;
+			targets_left++;
+		}
+	}
+
+	IndexPriorityQueue<Distance> q(paths.dist);
+	q.insert(origin_index);
+	while (!q.empty())
+	{
+		unsigned int v = q.extractMin();
+		if (!targets.empty() && target[v] && --targets_left == 0)
+			return;
+		if (contracted)
+		{
+			for (unsigned int s = shortcutOffsets[v]; s < shortcutOffsets[v + 1]; s++)
+			{
+				const Shortcut<Distance> &shortcut = shortcutSet[s];
+				unsigned int w = shortcut.dest;
+				if (paths.dist[v] + shortcut.weight < paths.dist[w])
+				{
+					bool queued = paths.dist[w] != Weights::infinity();
+					paths.dist[w] = paths.dist[v] + shortcut.weight;
+					paths.path[w] = v;
+					paths.via[w] = s;
+					if (queued)
+						q.decreaseKey(w);
+					else
+						q.insert(w);
+				}
+			}
+			continue;
+		}
+		for (unsigned int e = edgeOffsets[v]; e < edgeOffsets[v + 1];)
+		{
+			Edge<T> edge = readEdge(v, e);
+			unsigned int w = edge.dest;
+			W weight = edgeWeights[edge.id];
+			if (paths.dist[v] + weight < paths.dist[w])
+			{
+				bool queued = paths.dist[w] != Weights::infinity();
+				paths.dist[w] = paths.dist[v] + weight;
+				paths.path[w] = v;
+				if (queued)
+					q.decreaseKey(w);
+				else
+					q.insert(w);
+			}
+		}
+	}
+}
+
+/**
+ * Length of the shortest path found by an index based search to a vertex, in map units, INF if it was not reached
+ */
+template <class T, class W, class Direction>
+double Graph<T, W, Direction>::getPathLength(unsigned int dest_index, const Paths &paths) const
+{
+	Distance distance = paths.dist[dest_index];
+	return distance == Weights::infinity() ? INF : Weights::toLength(distance);
+}
+
+/**
+ * Vertices of the shortest path found by an index based search to a vertex, empty if it was not reached
+ */
+template <class T, class W, class Direction>
+vector<T> Graph<T, W, Direction>::getPathTo(unsigned int dest_index, const Paths &paths) const
+{
+	vector<T> res;
+	getPathTo(dest_index, paths, res);
+	return res;
+}
+
+/**
+ * Same as above, but writes the path to a buffer the caller can reuse between paths:
+ * walks the predecessors from the destination, unpacking the shape vertices of shortcuts, and reverses them once
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::getPathTo(unsigned int dest_index, const Paths &paths, vector<T> &path) const
+{
+	path.clear();
+	if (paths.dist[dest_index] == Weights::infinity())
+		return;
+	for (int current = dest_index; current != -1; current = paths.path[current])
+	{
+		path.push_back(vertexSet[current]);
+		if (!paths.via.empty() && paths.via[current] != -1)
+		{
+			const Shortcut<Distance> &shortcut = shortcutSet[paths.via[current]];
+			for (unsigned int i = shortcut.last_shape; i-- > shortcut.first_shape;)
+				path.push_back(vertexSet[shapes[i]]);
+		}
+	}
+	std::reverse(path.begin(), path.end());
+}
+
+/**
+ * Vertices of the shortest path to a vertex found by the last dijkstraShortestPath(origin)
+ */
+template <class T, class W, class Direction>
+vector<T> Graph<T, W, Direction>::getPathTo(const T &dest) const
+{
+	vector<T> res;
+	getPathTo(dest, res);
+	return res;
+}
+
+/**
+ * Same as above, but writes the path to a buffer the caller can reuse between paths
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::getPathTo(const T &dest, vector<T> &path) const
+{
+	path.clear();
+	int dest_index = findVertexIndex(dest);
+	if (dest_index != -1 && (unsigned int)dest_index < lastPaths.dist.size())
+		getPathTo(dest_index, lastPaths, path);
+}
+
+/**
+ * Checks if every vertex can be reached from origin, with an iterative depth-first search
+ */
+template <class T, class W, class Direction>
+bool Graph<T, W, Direction>::isConnected(T origin) const
+{
+	int origin_index = findVertexIndex(origin);
+	if (origin_index == -1)
+		return false;
+
+	std::vector<bool> visited(vertexSet.size(), false);
+	std::vector<unsigned int> stack(1, origin_index);
+	unsigned int number_visited = 1;
+	visited[origin_index] = true;
+	while (!stack.empty())
+	{
+		unsigned int v = stack.back();
+		stack.pop_back();
+		for (unsigned int e = edgeOffsets[v]; e < edgeOffsets[v + 1];)
+		{
+			unsigned int w = readEdge(v, e).dest;
+			if (!visited[w])
+			{
+				visited[w] = true;
+				number_visited++;
+				stack.push_back(w);
+			}
+		}
+	}
+
+	return number_visited == vertexSet.size();
+}
+
+/**
+ * Labels every vertex with its strongly connected component, with an iterative version of
+ * Tarjan's algorithm (one linear pass). The labels are kept until a vertex or an edge is added
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::updateComponents()
+{
+	if (componentsValid)
+		return;
+
+	unsigned int n = vertexSet.size();
+	component.assign(n, -1);
+	componentSizes.clear();
+
+	std::vector<unsigned int> order(n), low(n);
+	std::vector<bool> visited(n, false), onStack(n, false);
+	std::vector<unsigned int> stack;
+	std::vector<std::pair<unsigned int, unsigned int>> calls; // (vertex, next edge) of the simulated recursion
+	unsigned int counter = 0;
+
+	for (unsigned int s = 0; s < n; s++)
+	{
+		if (visited[s])
+			continue;
+
+		visited[s] = true;
+		order[s] = low[s] = counter++;
+		stack.push_back(s);
+		onStack[s] = true;
+		calls.push_back({s, edgeOffsets[s]});
+
+		while (!calls.empty())
+		{
+			unsigned int v = calls.back().first;
+			unsigned int e = calls.back().second;
+
+			if (e < edgeOffsets[v + 1])
+			{
+				unsigned int w = readEdge(v, e).dest;
+				calls.back().second = e;
+				if (!visited[w])
+				{
+					visited[w] = true;
+					order[w] = low[w] = counter++;
+					stack.push_back(w);
+					onStack[w] = true;
+					calls.push_back({w, edgeOffsets[w]});
+				}
+				else if (onStack[w])
+				{
+					low[v] = std::min(low[v], order[w]);
+				}
+				continue;
+			}
+
+			calls.pop_back();
+			if (!calls.empty())
+			{
+				unsigned int parent = calls.back().first;
+				low[parent] = std::min(low[parent], low[v]);
+			}
+
+			if (low[v] == order[v])
+			{
+				// v is the root of a component
+				unsigned int size = 0, w;
+				do
+				{
+					w = stack.back();
+					stack.pop_back();
+					onStack[w] = false;
+					component[w] = componentSizes.size();
+					size++;
+				} while (w != v);
+				componentSizes.push_back(size);
+			}
+		}
+	}
+
+	componentsValid = true;
+}
+
+template <class T, class W, class Direction>
+unsigned int Graph<T, W, Direction>::getNumComponents() const
+{
+	return componentSizes.size();
+}
+
+/**
+ * Strongly connected component of a vertex, -1 if there is no such vertex or the components are not up to date
+ */
+template <class T, class W, class Direction>
+int Graph<T, W, Direction>::getComponent(const T &in) const
+{
+	int index = findVertexIndex(in);
+	if (index == -1 || !componentsValid)
+		return -1;
+	return component[index];
+}
+
+template <class T, class W, class Direction>
+unsigned int Graph<T, W, Direction>::getComponentSize(int component) const
+{
+	return component < 0 || component >= (int)componentSizes.size() ? 0 : componentSizes[component];
+}
+
+/**
+ * Checks in constant time if each vertex can be reached from the other (updateComponents must be up to date)
+ */
+template <class T, class W, class Direction>
+bool Graph<T, W, Direction>::areStronglyConnected(const T &a, const T &b) const
+{
+	int component_a = getComponent(a);
+	return component_a != -1 && component_a == getComponent(b);
+}
+
+template <class T, class W, class Direction>
+int Graph<T, W, Direction>::getLargestComponent() const
+{
+	int largest = -1;
+	for (unsigned int c = 0; c < componentSizes.size(); c++)
+	{
+		if (largest == -1 || componentSizes[c] > componentSizes[largest])
+			largest = c;
+	}
+	return largest;
+}
+
+/**
+ * Removes every vertex outside a strongly connected component, and the edges to them.
+ * The remaining vertices are renumbered densely (indices), keeping their contents.
+ * Shortest paths inside a component never leave it, so distances between the remaining vertices do not change
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::keepComponent(int component)
+{
+	updateComponents();
+	if (component < 0 || component >= (int)componentSizes.size())
+		return;
+
+	// new index of each kept vertex; kept vertices move down in place, since they keep their order
+	unsigned int n = vertexSet.size();
+	std::vector<int> new_index(n, -1);
+	unsigned int kept = 0;
+	for (unsigned int v = 0; v < n; v++)
+	{
+		if (this->component[v] == component)
+		{
+			new_index[v] = kept;
+#ifndef COMPACT_GRAPH
+			vertexIndex[vertexSet[v]] = kept;
+#endif
+			vertexSet[kept] = vertexSet[v];
+			coordinates[kept] = coordinates[v];
+			kept++;
+		}
+#ifndef COMPACT_GRAPH
+		else
+			vertexIndex.erase(vertexSet[v]);
+#endif
+	}
+#ifdef COMPACT_GRAPH
+	unsigned int sorted = 0;
+	for (unsigned int index : sortedIndices)
+		if (new_index[index] != -1)
+			sortedIndices[sorted++] = new_index[index];
+	sortedIndices.resize(sorted);
+#endif
+
+	std::vector<unsigned int> sources;
+	std::vector<Edge<T>> edges;
+	for (unsigned int v = 0; v < n; v++)
+	{
+		for (unsigned int e = edgeOffsets[v]; e < edgeOffsets[v + 1];)
+		{
+			Edge<T> edge = readEdge(v, e);
+			if (new_index[v] != -1 && new_index[edge.dest] != -1)
+			{
+				sources.push_back(new_index[v]);
+				edges.push_back(Edge<T>(new_index[edge.dest], edge.id));
+			}
+		}
+	}
+
+	vertexSet.resize(kept);
+	coordinates.resize(kept);
+	buildAdjacency(sources, edges);
+	renumberEdges();
+
+	resetConnected();
+	componentsValid = false;
+	updateComponents();
+	clearContraction();
+
+	// the same files give another graph, identified by the smallest vertex kept
+	if (checksum != 0 && kept > 0)
+	{
+		std::ostringstream line;
+		line << "component " << kept << " " << *std::min_element(vertexSet.begin(), vertexSet.end());
+		checksum = hashLine(checksum, line.str());
+	}
+}
+
+/**
+ * Renumbers the edges in the order their sources appear in the vertex set, so the searches read the
+ * weights sequentially, and drops the weights of removed edges
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::renumberEdges()
+{
+#ifndef COMPACT_GRAPH
+	const unsigned int NONE = std::numeric_limits<unsigned int>::max();
+	std::vector<unsigned int> new_id(edgeWeights.size(), NONE);
+	std::vector<W> weights;
+	weights.reserve(edgeWeights.size());
+	for (Edge<T> &edge : adjacency)
+	{
+		if (new_id[edge.id] == NONE)
+		{
+			new_id[edge.id] = weights.size();
+			weights.push_back(edgeWeights[edge.id]);
+		}
+		edge.id = new_id[edge.id];
+	}
+	edgeWeights.assign(weights.begin(), weights.end());
+#endif
+	// the compact encoding numbers the edges this way as it is built (encodeAdjacency)
+}
+
+/**
+ * Renumbers the vertices so vertices close in the map are close in memory, which makes the searches
+ * and the other traversals read fewer cache lines. Vertex contents (ids) do not change, only their indices
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::reorderVertices(VertexOrder order)
+{
+	unsigned int n = vertexSet.size();
+	std::vector<unsigned int> new_order;
+	new_order.reserve(n);
+
+	if (order == HILBERT_ORDER)
+	{
+		double min_x = INF, min_y = INF, max_x = -INF, max_y = -INF;
+		for (const Coordinates &point : coordinates)
+		{
+			min_x = std::min<double>(min_x, point.x);
+			min_y = std::min<double>(min_y, point.y);
+			max_x = std::max<double>(max_x, point.x);
+			max_y = std::max<double>(max_y, point.y);
+		}
+		double scale = 65535 / std::max(std::max(max_x - min_x, max_y - min_y), 1e-9);
+		std::vector<std::pair<std::uint64_t, unsigned int>> keys(n);
+		for (unsigned int v = 0; v < n; v++)
+			keys[v] = {hilbertIndex((coordinates[v].x - min_x) * scale, (coordinates[v].y - min_y) * scale), v};
+		std::sort(keys.begin(), keys.end());
+		for (auto &key : keys)
+			new_order.push_back(key.second);
+	}
+	else if (order == BFS_ORDER)
+	{
+		// start each tree at a vertex of lowest degree
+		std::vector<unsigned int> by_degree(n), degree(n);
+		for (unsigned int v = 0; v < n; v++)
+		{
+			by_degree[v] = v;
+			degree[v] = getOutDegree(v);
+		}
+		auto lowerDegree = [&degree](unsigned int a, unsigned int b) { return degree[a] < degree[b]; };
+		std::stable_sort(by_degree.begin(), by_degree.end(), lowerDegree);
+		std::vector<bool> visited(n, false);
+		std::vector<unsigned int> neighbours;
+		for (unsigned int start : by_degree)
+		{
+			if (visited[start])
+				continue;
+			visited[start] = true;
+			new_order.push_back(start);
+			for (unsigned int next = new_order.size() - 1; next < new_order.size(); next++)
+			{
+				unsigned int v = new_order[next];
+				neighbours.clear();
+				for (unsigned int e = edgeOffsets[v]; e < edgeOffsets[v + 1];)
+				{
+					unsigned int w = readEdge(v, e).dest;
+					if (!visited[w])
+					{
+						visited[w] = true;
+						neighbours.push_back(w);
+					}
+				}
+				std::stable_sort(neighbours.begin(), neighbours.end(), lowerDegree);
+				new_order.insert(new_order.end(), neighbours.begin(), neighbours.end());
+			}
+		}
+	}
+	else
+		return;
+
+	reorderVertices(new_order);
+}
+
+/**
+ * Renumbers the vertices: order[i] is the current index of the vertex that gets index i.
+ * The adjacency rows keep their order, and the components and the union-find forest are rebuilt
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::reorderVertices(const std::vector<unsigned int> &order)
+{
+	unsigned int n = vertexSet.size();
+	std::vector<unsigned int> new_index(n);
+	for (unsigned int i = 0; i < n; i++)
+		new_index[order[i]] = i;
+
+	std::vector<T> ordered;
+	std::vector<Coordinates> ordered_coordinates;
+	std::vector<unsigned int> sources;
+	std::vector<Edge<T>> edges;
+	ordered.reserve(n);
+	ordered_coordinates.reserve(n);
+	sources.reserve(getNumEdges());
+	edges.reserve(getNumEdges());
+	for (unsigned int i = 0; i < n; i++)
+	{
+		unsigned int v = order[i];
+		ordered.push_back(vertexSet[v]);
+		ordered_coordinates.push_back(coordinates[v]);
+		for (unsigned int e = edgeOffsets[v]; e < edgeOffsets[v + 1];)
+		{
+			Edge<T> edge = readEdge(v, e);
+			sources.push_back(i);
+			edges.push_back(Edge<T>(new_index[edge.dest], edge.id));
+		}
+	}
+
+	// copied back, so the arrays keep their arena memory
+	vertexSet.assign(ordered.begin(), ordered.end());
+	coordinates.assign(ordered_coordinates.begin(), ordered_coordinates.end());
+#ifdef COMPACT_GRAPH
+	for (unsigned int &index : sortedIndices)
+		index = new_index[index];
+#else
+	for (unsigned int i = 0; i < n; i++)
+		vertexIndex[vertexSet[i]] = i;
+#endif
+	buildAdjacency(sources, edges);
+	renumberEdges();
+	resetConnected();
+	componentsValid = false;
+	updateComponents();
+}
+
+/**
+ * Number of stored edge weights: the number of edges, counting an undirected edge once
+ */
+template <class T, class W, class Direction>
+unsigned int Graph<T, W, Direction>::getNumEdgeWeights() const
+{
+	return edgeWeights.size();
+}
+
+template <class T, class W, class Direction>
+int Graph<T, W, Direction>::getNumEdges() const
+{
+#ifdef COMPACT_GRAPH
+	return numEdges;
+#else
+	return adjacency.size();
+#endif
+}
+
+/**
+ * Contracts the chains of shape vertices of the roads: a vertex whose only neighbours are the previous
+ * and the next vertex of a road (one way or both ways) is removed from the searches by index, and
+ * each chain of such vertices is replaced by a single shortcut between the vertices at its ends.
+ * The kept vertices (garage, companies, bus stops) are never contracted. Shortest distances between
+ * the remaining vertices do not change, and the shape vertices of each shortcut are kept to unpack paths.
+ * Vertex indices do not change. Only the searches with targets (dijkstraShortestPath with targets) run on
+ * the contracted core; updateComponents, reorderVertices and the searches without targets still traverse
+ * every vertex, since they need a result for the shape vertices too. Linear in the size of the graph
+ */
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::contractChains(const std::vector<T> &kept)
+{
+	unsigned int n = vertexSet.size();
+	clearContraction();
+
+	// incoming neighbours of each vertex
+	std::vector<unsigned int> in_offsets(n + 1, 0), in_neighbours;
+	for (unsigned int v = 0; v < n; v++)
+		for (unsigned int e = edgeOffsets[v]; e < edgeOffsets[v + 1];)
+			in_offsets[readEdge(v, e).dest + 1]++;
+	for (unsigned int i = 0; i < n; i++)
+		in_offsets[i + 1] += in_offsets[i];
+	in_neighbours.resize(in_offsets[n]);
+	std::vector<unsigned int> next_in(in_offsets.begin(), in_offsets.end() - 1);
+	for (unsigned int v = 0; v < n; v++)
+		for (unsigned int e = edgeOffsets[v]; e < edgeOffsets[v + 1];)
+			in_neighbours[next_in[readEdge(v, e).dest]++] = v;
+
+	core.assign(n, true);
+	for (const T &in : kept)
+	{
+		int index = findVertexIndex(in);
+		if (index != -1)
+			core[index] = false; // marked to keep, set back below
+	}
+	numCoreVertices = 0;
+	for (unsigned int v = 0; v < n; v++)
+	{
+		if (!core[v])
+		{
+			core[v] = true;
+			numCoreVertices++;
+			continue;
+		}
+		unsigned int out_degree = getOutDegree(v);
+		unsigned int in_degree = in_offsets[v + 1] - in_offsets[v];
+		if (out_degree > 2 || in_degree > 2 || out_degree == 0 || in_degree == 0)
+		{
+			numCoreVertices++;
+			continue;
+		}
+
+		// the neighbours must be exactly two vertices a and b, and every edge must continue the road:
+		// a -> v needs v -> b, b -> v needs v -> a, and no edge may be repeated
+		unsigned int neighbours[2];
+		unsigned int number_of_neighbours = 0;
+		bool shape = true;
+		auto addNeighbour = [&](unsigned int w) {
+			if (w == v)
+				shape = false;
+			else if ((number_of_neighbours < 1 || neighbours[0] != w) && (number_of_neighbours < 2 || neighbours[1] != w))
+			{
+				if (number_of_neighbours == 2)
+					shape = false;
+				else
+					neighbours[number_of_neighbours++] = w;
+			}
+		};
+		for (unsigned int e = edgeOffsets[v]; e < edgeOffsets[v + 1];)
+			addNeighbour(readEdge(v, e).dest);
+		for (unsigned int i = in_offsets[v]; i < in_offsets[v + 1]; i++)
+			addNeighbour(in_neighbours[i]);
+		shape = shape && number_of_neighbours == 2;
+		bool out_to[2] = {false, false}, in_from[2] = {false, false};
+		for (unsigned int side = 0; side < 2 && shape; side++)
+		{
+			for (unsigned int e = edgeOffsets[v]; e < edgeOffsets[v + 1];)
+			{
+				if (readEdge(v, e).dest == neighbours[side])
+				{
+					shape = shape && !out_to[side];
+					out_to[side] = true;
+				}
+			}
+			for (unsigned int i = in_offsets[v]; i < in_offsets[v + 1]; i++)
+			{
+				if (in_neighbours[i] == neighbours[side])
+				{
+					shape = shape && !in_from[side];
+					in_from[side] = true;
+				}
+			}
+		}
+		shape = shape && out_to[0] == in_from[1] && out_to[1] == in_from[0];
+		core[v] = !shape;
+		if (!shape)
+			numCoreVertices++;
+	}
+
+	// follow each chain from the kept vertex it starts at
+	shortcutOffsets.assign(n + 1, 0);
+	for (unsigned int v = 0; v < n; v++)
+	{
+		shortcutOffsets[v] = shortcutSet.size();
+		if (!core[v])
+			continue;
+		for (unsigned int e = edgeOffsets[v]; e < edgeOffsets[v + 1];)
+		{
+			Edge<T> edge = readEdge(v, e);
+			Shortcut<Distance> shortcut;
+			shortcut.weight = edgeWeights[edge.id];
+			shortcut.first_shape = shapes.size();
+			unsigned int previous = v, current = edge.dest;
+			while (!core[current])
+			{
+				shapes.push_back(current);
+				for (unsigned int next_e = edgeOffsets[current]; next_e < edgeOffsets[current + 1];)
+				{
+					Edge<T> next = readEdge(current, next_e);
+					if (next.dest != previous)
+					{
+						shortcut.weight += edgeWeights[next.id];
+						previous = current;
+						current = next.dest;
+						break;
+					}
+				}
+			}
+			shortcut.dest = current;
+			shortcut.last_shape = shapes.size();
+			shortcutSet.push_back(shortcut);
+		}
+	}
+	shortcutOffsets[n] = shortcutSet.size();
+}
+
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::clearContraction()
+{
+	core.clear();
+	shortcutOffsets.clear();
+	shortcutSet.clear();
+	shapes.clear();
+	numCoreVertices = 0;
+}
+
+template <class T, class W, class Direction>
+bool Graph<T, W, Direction>::isContracted() const
+{
+	return !core.empty();
+}
+
+/**
+ * Checks if a vertex was kept by the contraction (searches from or to it run on the shortcuts)
+ */
+template <class T, class W, class Direction>
+bool Graph<T, W, Direction>::isCoreVertex(const T &in) const
+{
+	int index = findVertexIndex(in);
+	return isContracted() && index != -1 && core[index];
+}
+
+template <class T, class W, class Direction>
+unsigned int Graph<T, W, Direction>::getNumCoreVertices() const
+{
+	return isContracted() ? numCoreVertices : vertexSet.size();
+}
+
+template <class T, class W, class Direction>
+unsigned int Graph<T, W, Direction>::getNumShortcuts() const
+{
+	return shortcutSet.size();
+}
+
+/**
+ * Load vertices and edges from .txt files and store them in the graph
+*/
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::loadNodesAndEdges(string city_name, LoadOptions options)
+{
+	std::string nodes_filename, edges_filename;
+	std::ifstream nodes, edges;
+
+	if (city_name == "testing")
+	{
+		nodes_filename = "resources/Mapas-20200424/GridGraphs/16x16/nodes.txt";
+		edges_filename = "resources/Mapas-20200424/GridGraphs/16x16/edges.txt";
+	}
+	else if (city_name.find("full") != std::string::npos || city_name.find("strong") != std::string::npos)
+	{
+		std::size_t pos = city_name.find("_");
+		string city_name_uppercase = city_name.substr(0, pos);
+		city_name_uppercase[0] = toupper(city_name_uppercase[0]);
+
+		nodes_filename = "resources/Mapas-20200424/PortugalMaps/PortugalMaps/New Maps/" + city_name_uppercase + "-20200523/" + city_name + "_nodes_xy.txt";
+		edges_filename = "resources/Mapas-20200424/PortugalMaps/PortugalMaps/New Maps/" + city_name_uppercase + "-20200523/" + city_name + "_edges.txt";
+		;
+	}
+	else
+	{
+		string city_name_lowercase = city_name;
+		city_name_lowercase[0] = tolower(city_name_lowercase[0]);
+
+		nodes_filename = "resources/Mapas-20200424/PortugalMaps/PortugalMaps/" + city_name + "/nodes_x_y_" + city_name_lowercase + ".txt";
+		edges_filename = "resources/Mapas-20200424/PortugalMaps/PortugalMaps/" + city_name + "/edges_" + city_name_lowercase + ".txt";
+	}
+
+	clear();
+
+	nodes.open(nodes_filename);
+	if (!nodes.good())
+	{
+		std::cout << "Unable to access file " << nodes_filename << std::endl;
+		return;
+	}
+
+	edges.open(edges_filename);
+	if (!edges.good())
+	{
+		std::cout << "Unable to access file " << edges_filename << std::endl;
+		return;
+	}
+
+	std::string line;
+	std::istringstream iss;
+	unsigned int node_id, n_nodes, n_edges, node_id_origin, node_id_destination;
+	double x, y;
+
+	// the checksum covers both files and the direction of the edges
+	// UNDIRECTED com grids, DIRECTED com maps
+	// professor deu-nos permissao para usar UNDIRECTED em todos os mapas devido à má conetividade
+	// (the default Direction of the graph)
+	checksum = hashLine(14695981039346656037ULL, std::to_string(Direction::undirected));
+	// distances of other weight types are rounded differently, so they are cached apart
+	if (!std::is_same<W, double>::value)
+		checksum = hashLine(checksum, std::string(std::is_integral<W>::value ? "fixed " : "float ") + std::to_string(sizeof(W)));
+
+	// read num of nodes
+	std::getline(nodes, line);
+	checksum = hashLine(checksum, line);
+	iss.str(line);
+	iss >> n_nodes;
+	// the edge count is not known yet, the arena grows for the edges
+	reserve(n_nodes, 0, 0);
+
+	// load nodes
+	for (unsigned int i = 0; i < n_nodes; i++)
+	{
+		std::getline(nodes, line);
+		checksum = hashLine(checksum, line);
+		sscanf(line.c_str(), "(%d, %lf, %lf)", &node_id, &x, &y);
+		addVertex(node_id, x, y);
+	}
+
+	// read num of edges
+	std::getline(edges, line);
+	checksum = hashLine(checksum, line);
+	sscanf(line.c_str(), "%d", &n_edges);
+	unsigned int n_directions = Direction::undirected ? 2 * n_edges : n_edges;
+	reserve(0, n_directions, n_edges);
+
+	//load edges, then build the adjacency rows at once
+	std::vector<unsigned int> sources;
+	std::vector<Edge<T>> edge_list;
+	sources.reserve(n_directions);
+	edge_list.reserve(n_directions);
+	for (unsigned int i = 0; i < n_edges; i++)
+	{
+		std::getline(edges, line);
+		checksum = hashLine(checksum, line);
+		sscanf(line.c_str(), "(%d, %d)", &node_id_origin, &node_id_destination);
+		int origin = findVertexIndex(node_id_origin), destination = findVertexIndex(node_id_destination);
+		if (origin == -1 || destination == -1)
+			continue;
+		edgeWeights.push_back(Weights::fromLength(getDistance(origin, destination)));
+		if (Direction::undirected)
+		{
+			sources.push_back(destination);
+			edge_list.push_back(Edge<T>(origin, edgeWeights.size() - 1));
+		}
+		sources.push_back(origin);
+		edge_list.push_back(Edge<T>(destination, edgeWeights.size() - 1));
+		uniteConnected(origin, destination);
+	}
+
+	nodes.close();
+	edges.close();
+
+	// the options change the vertices kept and their indices, so the cache files made with others do not match
+	checksum = hashLine(checksum, "components " + std::to_string(options.components) + " order " + std::to_string(options.order));
+
+	buildAdjacency(sources, edge_list);
+	// reorderVertices renumbers the edges itself
+	if (options.order != FILE_ORDER)
+		reorderVertices(options.order);
+	else
+		renumberEdges();
+	// compress every path of the union-find forest built while adding the edges
+	for (unsigned int i = 0; i < vertexSet.size(); i++)
+		findConnected(i);
+	updateComponents();
+	if (options.components == LARGEST_COMPONENT)
+	{
+		keepComponent(getLargestComponent());
+	}
+}
+
+/** 
+ * Draw all vertices and edges of the map
+*/
+template <class T, class W, class Direction>
+void Graph<T, W, Direction>::drawGraph(GraphViewer *gv)
+{
+	double relative_x, relative_y;
+	unsigned int edge_id = 0;
+
+	// add vertices
+	for (unsigned int i = 0; i < vertexSet.size(); i++)
+	{
+		if (i == 0)
+		{
+			relative_x = coordinates[i].x;
+			relative_y = coordinates[i].y;
+		}
+
+		gv->addNode(vertexSet[i], coordinates[i].x - relative_x, coordinates[i].y - relative_y);
+		gv->setVertexSize(vertexSet[i], 16);
+	}
+
+	// add edges, an undirected edge once
+	std::vector<bool> drawn(edgeWeights.size(), false);
+	for (unsigned int i = 0; i < vertexSet.size(); i++)
+	{
+		for (unsigned int e = edgeOffsets[i]; e < edgeOffsets[i + 1];)
+		{
+			Edge<T> edge = readEdge(i, e);
+			if (drawn[edge.id])
+				continue;
+			drawn[edge.id] = true;
+			gv->addEdge(edge_id, vertexSet[i], vertexSet[edge.dest], Direction::undirected ? EdgeType::UNDIRECTED : EdgeType::DIRECTED);
+			++edge_id;
+		}
+	}
+
+	gv->rearrange();
+}
+
+#endif /* GRAPH_H_ */
@@ -4,6 +4,8 @@
 #ifndef INTERFACE_H_
 #define INTERFACE_H_
 
+#include <unordered_set>
+
 #include "Manager.h"
 #include "lib/graphviewer.h"
 
@@ -19,45 +21,58 @@
 
 /************************* Interface  **************************/
 
-template <class T>
+template <class T, class W = DefaultWeight, class Direction = Undirected>
 class Interface
 {
-    Manager<T> *manager;
+    Manager<T, W, Direction> *manager;
     GraphViewer *gv;
 
 public:
-    Interface(Manager<T> *manager);
+    Interface(Manager<T, W, Direction> *manager);
+    ~Interface();
 
     void openGraphViewerWindow() const;
     void setGarageColor() const;
-    void setLocationsColors(Company<T> company) const;
-    void chooseMap();
+    void setLocationsColors(const Company<T> &company) const;
+    bool chooseMap();
     void initializeGraphViewer();
+    void closeGraphViewer();
+    ComponentFilter chooseComponentFilter() const;
+    VertexOrder chooseVertexOrder() const;
+    void keepComponent(int component);
     void pickGarageVertexId();
     void setFirstBus();
     void changeGarageVertexId();
-    void menu();
+    bool menu();
     void companiesMenu();
     void manageCompanyMenu(Company<T> &company);
     void addCompanyMenu();
     void removeCompanyMenu();
-    void printAndDrawBusesRoutes(Company<T> company) const;
+    void printAndDrawBusesRoutes(unsigned int company_index) const;
+    void printAndDrawTrip(unsigned int company_index, const TripPlan<T> &trip) const;
     void resetVerticesColor() const;
     void manageBuses();
     int getVertexIndex(T vertex_id) const;
+    void warnDisconnected(const Company<T> &company) const;
 };
 
 /**
  * .cpp
 */
 
-template <class T>
-Interface<T>::Interface(Manager<T> *manager) : manager(manager)
+template <class T, class W, class Direction>
+Interface<T, W, Direction>::Interface(Manager<T, W, Direction> *manager) : manager(manager), gv(NULL)
 {
 }
 
-template <class T>
-void Interface<T>::openGraphViewerWindow() const
+template <class T, class W, class Direction>
+Interface<T, W, Direction>::~Interface()
+{
+    closeGraphViewer();
+}
+
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::openGraphViewerWindow() const
 {
     unsigned int size, dashed, curved;
     dashed = false;
@@ -71,8 +86,8 @@ void Interface<T>::openGraphViewerWindow() const
     gv->defineVertexSize(size);
 }
 
-template <class T>
-void Interface<T>::setGarageColor() const
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::setGarageColor() const
 {
     if (gv != NULL)
     {
@@ -87,8 +102,8 @@ void Interface<T>::setGarageColor() const
 /**
  * Set colors for companies, garage and bus stops vertices
  */
-template <class T>
-void Interface<T>::setLocationsColors(Company<T> company) const
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::setLocationsColors(const Company<T> &company) const
 {
     if (gv != NULL)
     {
@@ -106,8 +121,11 @@ void Interface<T>::setLocationsColors(Company<T> company) const
     }
 }
 
-template <class T>
-void Interface<T>::chooseMap()
+/**
+ * Loads the chosen map and opens the menu. Returns true if the user wants to choose another map
+ */
+template <class T, class W, class Direction>
+bool Interface<T, W, Direction>::chooseMap()
 {
     std::cout << "===============================\n";
     std::cout << "BosHBus: Workers Transportation\n";
@@ -207,7 +225,19 @@ void Interface<T>::chooseMap()
 
     if (!city_name.empty())
     {
-        manager->getGraph().loadNodesAndEdges(city_name);
+        ComponentFilter components = chooseComponentFilter();
+        LoadOptions options;
+        options.order = chooseVertexOrder();
+
+        // components are dropped after loading, to report what is dropped
+        Graph<T, W, Direction> &graph = manager->getGraph();
+        graph.loadNodesAndEdges(city_name, options);
+        std::cout << "Loaded " << graph.getNumVertex() << " vertices and " << graph.getNumEdges() << " edges in "
+                  << graph.getMemoryUsed() / 1024 << " KB (" << graph.getMemoryReserved() / 1024 << " KB reserved)\n";
+        if (components == LARGEST_COMPONENT)
+        {
+            keepComponent(graph.getLargestComponent());
+        }
         if (city_name == "testing")
         {
             manager->loadTagsFile();
@@ -215,15 +245,105 @@ void Interface<T>::chooseMap()
 
         // pick garage vertex id
         pickGarageVertexId();
+        if (components == GARAGE_COMPONENT)
+        {
+            keepComponent(graph.getComponent(manager->getGarageVertexId()));
+        }
+        // the checksum of the graph covers the components kept
+        manager->openDistanceCache();
 
         setFirstBus();
 
-        menu();
+        if (menu())
+        {
+            // the map, its companies and buses are dropped before the next map is loaded
+            closeGraphViewer();
+            manager->clear();
+            return true;
+        }
+    }
+    return false;
+}
+
+template <class T, class W, class Direction>
+ComponentFilter Interface<T, W, Direction>::chooseComponentFilter() const
+{
+    std::cout << "\nLoad options:\n";
+    std::cout << "1 - Whole map\n";
+    std::cout << "2 - Only the largest strongly connected component\n";
+    std::cout << "3 - Only the strongly connected component of the garage\n";
+    std::cout << "Option (default 1): ";
+
+    int option;
+    std::cin >> option;
+    if (cin.fail())
+    {
+        option = 1;
+        cin.clear();
+    }
+    cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+    switch (option)
+    {
+    case 2:
+        return LARGEST_COMPONENT;
+    case 3:
+        return GARAGE_COMPONENT;
+    default:
+        return ALL_COMPONENTS;
+    }
+}
+
+template <class T, class W, class Direction>
+VertexOrder Interface<T, W, Direction>::chooseVertexOrder() const
+{
+    std::cout << "\nVertex order (vertex indices change, ids do not):\n";
+    std::cout << "1 - As in the map files\n";
+    std::cout << "2 - Along a Hilbert curve\n";
+    std::cout << "3 - Breadth-first (Cuthill-McKee)\n";
+    std::cout << "Option (default 1): ";
+
+    int option;
+    std::cin >> option;
+    if (cin.fail())
+    {
+        option = 1;
+        cin.clear();
+    }
+    cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+    switch (option)
+    {
+    case 2:
+        return HILBERT_ORDER;
+    case 3:
+        return BFS_ORDER;
+    default:
+        return FILE_ORDER;
     }
 }
 
-template <class T>
-void Interface<T>::pickGarageVertexId()
+/**
+ * Keeps only one strongly connected component of the map and reports what was dropped
+ */
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::keepComponent(int component)
+{
+    Graph<T, W, Direction> &graph = manager->getGraph();
+    int number_of_vertices = graph.getNumVertex();
+    int number_of_edges = graph.getNumEdges();
+    int number_of_components = graph.getNumComponents();
+
+    graph.keepComponent(component);
+
+    std::cout << "Kept 1 of " << number_of_components << " strongly connected components: "
+              << graph.getNumVertex() << " vertices and " << graph.getNumEdges() << " edges (dropped "
+              << number_of_vertices - graph.getNumVertex() << " vertices and "
+              << number_of_edges - graph.getNumEdges() << " edges)\n";
+}
+
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::pickGarageVertexId()
 {
     bool done = false;
     while (!done)
@@ -234,7 +354,7 @@ void Interface<T>::pickGarageVertexId()
         std::cin >> index;
         if (!cin.fail() && index >= 0 && index < manager->getGraph().getNumVertex())
         {
-            manager->getGarageVertexId() = manager->getGraph().getVertexSet()[index]->getInfo();
+            manager->getGarageVertexId() = manager->getGraph().getVertexSet()[index];
             done = true;
         }
         else
@@ -250,8 +370,8 @@ void Interface<T>::pickGarageVertexId()
     }
 }
 
-template <class T>
-void Interface<T>::setFirstBus()
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::setFirstBus()
 {
     bool done = false;
     while (!done)
@@ -282,8 +402,8 @@ void Interface<T>::setFirstBus()
     }
 }
 
-template <class T>
-void Interface<T>::initializeGraphViewer()
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::initializeGraphViewer()
 {
     // initialize graphviewer
     unsigned int dynamic;
@@ -293,10 +413,24 @@ void Interface<T>::initializeGraphViewer()
 }
 
 /**
- * Menu interface
+ * Closes the map window, if it was opened
+ */
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::closeGraphViewer()
+{
+    if (gv != NULL)
+    {
+        gv->closeWindow();
+        delete gv;
+        gv = NULL;
+    }
+}
+
+/**
+ * Menu interface. Returns true to choose another map, false to exit
 */
-template <class T>
-void Interface<T>::menu()
+template <class T, class W, class Direction>
+bool Interface<T, W, Direction>::menu()
 {
     bool done = false;
     while (!done)
@@ -317,6 +451,8 @@ void Interface<T>::menu()
         std::cout << "6 - Hide Vertices Label on Map Window\n";
         std::cout << "7 - Change Garage Location (" << getVertexIndex(manager->getGarageVertexId()) << ")\n";
         std::cout << "8 - Check Graph Connectivity\n";
+        std::cout << "9 - Turn " << (manager->getReportOptimalityGap() ? "Off" : "On") << " Annealing Optimality Gap Report\n";
+        std::cout << "10 - Choose Another Map\n";
         std::cout << "Any other key - Exit\n\n";
         std::cout << "Option: ";
 
@@ -344,40 +480,50 @@ void Interface<T>::menu()
         break;
         case 2:
         {
-            manager->sortBusesAscendingCapacity();
-            manager->clearBusesPaths();
+            std::cout << "Optimizer:\n";
+            std::cout << "1 - Simulated Annealing\n";
+            std::cout << "2 - Ruin and Recreate (large companies)\n";
+            std::cout << "3 - Cluster First, Route Second (very large companies)\n";
+            std::cout << "Option: ";
+
+            int optimizer_option;
+            std::cin >> optimizer_option;
+            if (cin.fail())
+            {
+                optimizer_option = -1;
+                cin.clear();
+            }
+            cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 
-            double distance;
-            for (auto &company : manager->getCompanies())
+            Optimizer optimizer = SIMULATED_ANNEALING;
+            if (optimizer_option == 2)
+            {
+                optimizer = RUIN_AND_RECREATE;
+            }
+            else if (optimizer_option == 3)
             {
+                optimizer = CLUSTER_FIRST;
+            }
+
+            manager->sortBusesAscendingCapacity();
+            // each company is shown as soon as it is planned, while the next ones are still being planned
+            manager->planCompanies(optimizer, [this](unsigned int i, const CompanyPlan<T> &plan) {
+                Company<T> &company = manager->getCompanies()[i];
                 std::cout << "\nCompany: " << company.name << "\n";
                 if (company.bus_stops.size() > 0)
                 {
-                    setLocationsColors(company);
-
-                    std::cout << "To work:\n";
-                    distance = manager->simulatedAnnealing(company, "company");
-                    if (distance == -1)
-                    {
-                        std::cout << "This trip is not possible due to graph connectivity\n";
-                    }
-                    else
+                    if (plan.to_company.buses.empty())
                     {
-                        std::cout << "Total Distance: " << distance << "\n";
-                        printAndDrawBusesRoutes(company);
+                        std::cout << "Not enough buses to provide transportation to " << company.name << " workers\n\n";
+                        return;
                     }
 
-                    std::cout << "Back home:\n";
-                    setLocationsColors(company);
-                    distance = manager->simulatedAnnealing(company, "garage");
-                    if (distance == -1)
-                    {
-                        std::cout << "This trip is not possible due to graph connectivity\n";
-                    }
-                    else
+                    std::cout << "To work:\n";
+                    printAndDrawTrip(i, plan.to_company);
+                    if (plan.to_company.distance != -1)
                     {
-                        std::cout << "Total Distance: " << distance << "\n";
-                        printAndDrawBusesRoutes(company);
+                        std::cout << "Back home:\n";
+                        printAndDrawTrip(i, plan.to_garage);
                     }
 
                     // reset colors
@@ -389,7 +535,7 @@ void Interface<T>::menu()
                     std::cout << "This company has no bus stops\n";
                 }
                 std::cout << "\n";
-            }
+            });
 
             std::cout << "PRESS ENTER TO GO BACK TO MENU";
             getchar();
@@ -410,9 +556,9 @@ void Interface<T>::menu()
             if (gv != NULL)
             {
                 int i = 0;
-                for (auto *vertex : manager->getGraph().getVertexSet())
+                for (const T &vertex_id : manager->getGraph().getVertexSet())
                 {
-                    gv->setVertexLabel(vertex->getInfo(), std::to_string(i));
+                    gv->setVertexLabel(vertex_id, std::to_string(i));
                     ++i;
                 }
                 gv->rearrange();
@@ -423,9 +569,9 @@ void Interface<T>::menu()
         {
             if (gv != NULL)
             {
-                for (auto *vertex : manager->getGraph().getVertexSet())
+                for (const T &vertex_id : manager->getGraph().getVertexSet())
                 {
-                    gv->clearVertexLabel(vertex->getInfo());
+                    gv->clearVertexLabel(vertex_id);
                 }
                 gv->rearrange();
             }
@@ -438,7 +584,9 @@ void Interface<T>::menu()
         break;
         case 8:
         {
-            if (manager->getGraph().isConnected(manager->getGarageVertexId()))
+            Graph<T, W, Direction> &graph = manager->getGraph();
+            graph.updateComponents();
+            if (graph.getNumComponents() == 1)
             {
                 std::cout << "============================\n";
                 std::cout << "The graph is fully connected\n";
@@ -449,20 +597,63 @@ void Interface<T>::menu()
                 std::cout << "================================\n";
                 std::cout << "The graph is NOT fully connected\n";
                 std::cout << "================================\n";
+
+                unsigned int largest = 0;
+                for (unsigned int c = 0; c < graph.getNumComponents(); c++)
+                {
+                    largest = std::max(largest, graph.getComponentSize(c));
+                }
+                std::cout << "Strongly connected components: " << graph.getNumComponents() << "\n";
+                std::cout << "Largest component: " << largest << " of " << graph.getNumVertex() << " vertices\n";
+                std::cout << "Garage component: " << graph.getComponentSize(graph.getComponent(manager->getGarageVertexId())) << " vertices\n";
+
+                for (auto &company : manager->getCompanies())
+                {
+                    if (!graph.areStronglyConnected(manager->getGarageVertexId(), company.company_vertex_id))
+                    {
+                        std::cout << "Company " << company.name << " is not connected to the garage\n";
+                    }
+                    unsigned int unreachable = 0;
+                    for (auto &stop : company.bus_stops)
+                    {
+                        if (!graph.areStronglyConnected(manager->getGarageVertexId(), stop.vertex_id))
+                        {
+                            unreachable++;
+                        }
+                    }
+                    if (unreachable > 0)
+                    {
+                        std::cout << "Company " << company.name << ": " << unreachable << " bus stops are not connected to the garage\n";
+                    }
+                }
+            }
+
+            if (graph.isContracted())
+            {
+                std::cout << "Searches run on " << graph.getNumCoreVertices() << " of " << graph.getNumVertex()
+                          << " vertices (" << graph.getNumShortcuts() << " shortcuts replace the chains of shape vertices)\n";
             }
 
             std::cout << "PRESS ENTER TO GO BACK TO MENU";
             getchar();
         }
         break;
+        case 9:
+        {
+            manager->getReportOptimalityGap() = !manager->getReportOptimalityGap();
+        }
+        break;
+        case 10:
+            return true;
         default:
             done = true;
         }
     }
+    return false;
 }
 
-template <class T>
-void Interface<T>::changeGarageVertexId()
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::changeGarageVertexId()
 {
     std::cout << "======================\n";
     std::cout << "Change Garage Location\n";
@@ -476,7 +667,11 @@ void Interface<T>::changeGarageVertexId()
 
     if (!cin.fail() && vertex_index >= 0 && vertex_index < manager->getGraph().getNumVertex())
     {
-        manager->getGarageVertexId() = manager->getGraph().getVertexSet()[vertex_index]->getInfo();
+        manager->getGarageVertexId() = manager->getGraph().getVertexSet()[vertex_index];
+        for (auto &company : manager->getCompanies())
+        {
+            warnDisconnected(company);
+        }
     }
     else if (cin.fail())
     {
@@ -485,8 +680,8 @@ void Interface<T>::changeGarageVertexId()
     cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 }
 
-template <class T>
-void Interface<T>::manageBuses()
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::manageBuses()
 {
     bool done = false;
     while (!done)
@@ -582,8 +777,8 @@ void Interface<T>::manageBuses()
     }
 }
 
-template <class T>
-void Interface<T>::companiesMenu()
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::companiesMenu()
 {
     bool done = false;
     while (!done)
@@ -638,8 +833,8 @@ void Interface<T>::companiesMenu()
     }
 }
 
-template <class T>
-void Interface<T>::manageCompanyMenu(Company<T> &company)
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::manageCompanyMenu(Company<T> &company)
 {
     bool done = false;
     while (!done)
@@ -738,9 +933,10 @@ void Interface<T>::manageCompanyMenu(Company<T> &company)
                         if (number_of_workers > 0)
                         {
                             Stop<T> stop;
-                            stop.vertex_id = manager->getGraph().getVertexSet()[vertex_index]->getInfo();
+                            stop.vertex_id = manager->getGraph().getVertexSet()[vertex_index];
                             stop.number_of_workers = number_of_workers;
                             company_bus_stops.push_back(stop);
+                            warnDisconnected(company);
                         }
                     }
                 }
@@ -766,7 +962,8 @@ void Interface<T>::manageCompanyMenu(Company<T> &company)
 
             if (!cin.fail() && vertex_index >= 0 && vertex_index < manager->getGraph().getNumVertex())
             {
-                company.company_vertex_id = manager->getGraph().getVertexSet()[vertex_index]->getInfo();
+                company.company_vertex_id = manager->getGraph().getVertexSet()[vertex_index];
+                warnDisconnected(company);
             }
             else if (cin.fail())
             {
@@ -782,8 +979,8 @@ void Interface<T>::manageCompanyMenu(Company<T> &company)
     }
 }
 
-template <class T>
-void Interface<T>::addCompanyMenu()
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::addCompanyMenu()
 {
     std::cout << "===============\n";
     std::cout << "Add New Company\n";
@@ -801,8 +998,9 @@ void Interface<T>::addCompanyMenu()
     {
         Company<T> company;
         company.name = name;
-        company.company_vertex_id = manager->getGraph().getVertexSet()[company_vertex_index]->getInfo();
+        company.company_vertex_id = manager->getGraph().getVertexSet()[company_vertex_index];
         manager->getCompanies().push_back(company);
+        warnDisconnected(company);
     }
     else if (cin.fail())
     {
@@ -811,8 +1009,8 @@ void Interface<T>::addCompanyMenu()
     cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 }
 
-template <class T>
-void Interface<T>::removeCompanyMenu()
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::removeCompanyMenu()
 {
     std::vector<Company<T>> &companies = manager->getCompanies();
 
@@ -835,71 +1033,88 @@ void Interface<T>::removeCompanyMenu()
     cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 }
 
-template <class T>
-void Interface<T>::printAndDrawBusesRoutes(Company<T> company) const
+/**
+ * Sets the paths of the buses of a planned trip and shows them
+ */
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::printAndDrawTrip(unsigned int company_index, const TripPlan<T> &trip) const
+{
+    const Company<T> &company = manager->getCompanies()[company_index];
+    setLocationsColors(company);
+    manager->setBusesPaths(trip);
+    for (const std::string &warning : trip.warnings)
+    {
+        std::cout << warning << "\n";
+    }
+    if (trip.distance == -1)
+    {
+        std::cout << "This trip is not possible due to graph connectivity\n";
+        warnDisconnected(company);
+    }
+    else
+    {
+        std::cout << "Total Distance: " << trip.distance << "\n";
+        printAndDrawBusesRoutes(company_index);
+    }
+}
+
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::printAndDrawBusesRoutes(unsigned int company_index) const
 {
-    for (Bus<T> bus : manager->getBuses())
+    const Company<T> &company = manager->getCompanies()[company_index];
+    for (Bus<T> *bus_for_company : manager->getFleet().getAssigned(company_index))
     {
+        Bus<T> &bus = *bus_for_company;
         if (!bus.path.empty())
         {
-            if (bus.path[0] == company.company_vertex_id ||
-                bus.path[bus.path.size() - 1] == company.company_vertex_id)
+            // print bus route
+            std::cout << "Bus Id " << bus.id << ", Capacity " << bus.capacity << "\n";
+            std::cout << "Route: ";
+            for (unsigned int i = 0; i < bus.path.size(); i++)
             {
-                // print bus route
-                std::cout << "Bus Id " << bus.id << ", Capacity " << bus.capacity << "\n";
-                std::cout << "Route: ";
-                for (unsigned int i = 0; i < bus.path.size(); i++)
+                std::cout << getVertexIndex(bus.path[i]);
+                if (i + 1 != bus.path.size())
                 {
-                    std::cout << getVertexIndex(bus.path[i]);
-                    if (i + 1 != bus.path.size())
-                    {
-                        std::cout << "->";
-                    }
+                    std::cout << "->";
                 }
-                std::cout << "\n";
+            }
+            std::cout << "\n";
 
-                // draw bus route
-                if (gv != NULL)
+            // draw bus route
+            if (gv != NULL)
+            {
+                // the geometry was found while planning, the bus stops keep their colors
+                std::unordered_set<T> stops(bus.path.begin(), bus.path.end());
+                for (T vertex : bus.geometry)
                 {
-                    for (unsigned int i = 0; i + 1 < bus.path.size(); i++)
+                    if (stops.find(vertex) == stops.end())
                     {
-                        manager->getGraph().dijkstraShortestPath(bus.path[i]);
-                        manager->getGraph().getPathTo(bus.path[i + 1]);
-                        Vertex<T> *vertex = manager->getGraph().findVertex(bus.path[i + 1]);
-                        Vertex<T> *path = vertex->getPath();
-                        if (path != NULL)
-                        {
-                            while (path->getPath() != NULL)
-                            {
-                                gv->setVertexColor(path->getInfo(), RED);
-                                path = path->getPath();
-                            }
-                        }
+                        gv->setVertexColor(vertex, RED);
                     }
-                    gv->rearrange();
+                }
+                gv->rearrange();
 
-                    std::cout << "PRESS ENTER TO CONTINUE";
-                    getchar();
+                std::cout << "PRESS ENTER TO CONTINUE";
+                getchar();
 
-                    // reset colors
-                    resetVerticesColor();
-                    setGarageColor();
-                    setLocationsColors(company);
-                }
+                // reset colors
+                resetVerticesColor();
+                setGarageColor();
+                setLocationsColors(company);
             }
         }
     }
 }
 
-template <class T>
-void Interface<T>::resetVerticesColor() const
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::resetVerticesColor() const
 {
     if (gv != NULL)
     {
         int index = 0;
-        for (Vertex<T> *vertex : manager->getGraph().getVertexSet())
+        for (const T &vertex_id : manager->getGraph().getVertexSet())
         {
-            gv->setVertexColor(vertex->getInfo(), VERTEX_COLOR);
+            gv->setVertexColor(vertex_id, VERTEX_COLOR);
             ++index;
         }
 
@@ -907,20 +1122,23 @@ void Interface<T>::resetVerticesColor() const
     }
 }
 
-template <class T>
-int Interface<T>::getVertexIndex(T vertex_id) const
+template <class T, class W, class Direction>
+int Interface<T, W, Direction>::getVertexIndex(T vertex_id) const
 {
-    int index = 0;
-    for (auto *vertex : manager->getGraph().getVertexSet())
+    return manager->getGraph().findVertexIndex(vertex_id);
+}
+
+/**
+ * Warns about the company or bus stops with no road to or from the garage (Manager::getDisconnectedLocations)
+ */
+template <class T, class W, class Direction>
+void Interface<T, W, Direction>::warnDisconnected(const Company<T> &company) const
+{
+    for (T vertex_id : manager->getDisconnectedLocations(company))
     {
-        if (vertex->getInfo() == vertex_id)
-        {
-            return index;
-        }
-        ++index;
+        std::cout << "Warning: " << (vertex_id == company.company_vertex_id ? "company " : "bus stop ")
+                  << getVertexIndex(vertex_id) << " of " << company.name << " has no road to or from the garage\n";
     }
-
-    return -1;
 }
 
 #endif /* INTERFACE_H_ */
@@ -15,20 +15,17 @@
 #include <unordered_map>
 #include <utility> // std::pair
 #include <chrono>
+#include <memory>
+#include <functional>
 
 #include "Graph.h"
+#include "Fleet.h"
+#include "StopMatrix.h"
+#include "Routing.h"
+#include "ThreadPool.h"
 
 int global_bus_id = 0;
 
-/************************* Bus  **************************/
-template <class T>
-struct Bus
-{
-    T id;
-    T capacity;
-    std::vector<T> path;
-};
-
 /************************* Stop  **************************/
 template <class T>
 struct Stop
@@ -44,48 +41,107 @@ struct Company
     std::string name;
     T company_vertex_id;
     std::vector<Stop<T>> bus_stops;
+
+    StopMatrix<T> distances;                      // distances of the last plan, updated incrementally
+    std::vector<SavedRoute<T>> to_company_routes; // routes of the last plan, to warm start the next one
+    std::vector<SavedRoute<T>> to_garage_routes;
 };
 
-#define MAX std::numeric_limits<T>::max()
+/************************* TripPlan  **************************/
+template <class T>
+struct TripPlan
+{
+    std::vector<Bus<T> *> buses;       // buses given to the trip, none if there are not enough buses
+    std::vector<std::vector<T>> paths; // path of each bus, empty if the bus is not used
+    std::vector<std::vector<T>> geometry; // every vertex driven through by each bus (getPathsGeometry)
+    double distance = 0;               // total distance, -1 if the trip is not possible
+    std::vector<std::string> warnings; // found while planning, possibly in parallel, shown with the trip
+};
 
-// A hash function used to hash a pair of any kind
-struct pair_hash
+/************************* CompanyPlan  **************************/
+template <class T>
+struct CompanyPlan
 {
-    template <class T>
-    std::size_t operator()(const std::pair<T, T> &p) const
-    {
-        auto h1 = std::hash<T>{}(p.first);
-        auto h2 = std::hash<T>{}(p.second);
+    TripPlan<T> to_company; // from the garage to the company
+    TripPlan<T> to_garage;  // from the company back to the garage
+};
 
-        return h1 ^ h2;
-    }
+#define MAX std::numeric_limits<T>::max()
+
+/************************* Optimizer  **************************/
+enum Optimizer
+{
+    SIMULATED_ANNEALING,
+    RUIN_AND_RECREATE,
+    CLUSTER_FIRST // one geographic cluster of bus stops per bus, each route optimized in parallel
 };
 
+// companies with more bus stops than this are always planned by clusters (the matrix grows with stops^2)
+#define MAX_MATRIX_STOPS 1000
+
+// up to this many companies, allocateFleet tries every order of the companies (n! orders)
+#define MAX_SPLIT_ORDERS_COMPANIES 6
+
+// annealing starting temperature, as a fraction of the typical move length change of the instance
+#define COLD_START_TEMPERATURE 1.0
+#define WARM_START_TEMPERATURE 0.1
+// final annealing temperature, as a fraction of the starting one
+#define FINAL_TEMPERATURE 0.001
+// random moves sampled to find the typical move length change
+#define TEMPERATURE_SAMPLES 200
+
 /************************* Manager  **************************/
 
-template <class T>
+template <class T, class W = DefaultWeight, class Direction = Undirected>
 class Manager
 {
-    Graph<T> graph;
+    Graph<T, W, Direction> graph;
     T garage_vertex_id;
     std::vector<Bus<T>> buses;
+    Fleet<T> fleet;
+    mutable DistanceCache<T> distance_cache; // distances between bus stops of the map, kept between runs
     std::vector<Company<T>> companies;
+    bool report_optimality_gap = false;
+
+    std::vector<std::vector<Stop<T>>> getClusters(const Company<T> &company, std::vector<Bus<T> *> buses,
+                                                  std::vector<Stop<T>> &unserved);
+    double planClusters(const Company<T> &company, std::vector<Bus<T> *> buses, string direction,
+                        std::vector<std::string> &warnings);
+    void optimizePlan(RoutePlan<T> &plan, const StopMatrix<T> &distances, Optimizer optimizer) const;
+    const StopMatrix<T> &updateBusStopsDistances(Company<T> &company) const;
+    TripPlan<T> planTrip(Company<T> &company, std::vector<Bus<T> *> buses, string direction, Optimizer optimizer) const;
+    double estimateBusCost(const Company<T> &company) const;
+    unsigned int splitFleet(const std::vector<unsigned int> &order, const std::vector<T> &demands,
+                            const std::vector<double> &bus_costs, Fleet<T> &split_fleet,
+                            std::vector<std::vector<Bus<T> *>> &buses_for_companies, double &cost) const;
+    std::vector<std::vector<Bus<T> *>> allocateFleet();
+    std::vector<std::vector<T>> getPathsGeometry(const std::vector<std::vector<T>> &paths) const;
+    bool areStopsReachable(const Company<T> &company) const;
+    void contractGraph();
+    TripPlan<T> planClusterTrip(const Company<T> &company, std::vector<Bus<T> *> buses, string direction);
+    CompanyPlan<T> planCompany(Company<T> &company, std::vector<Bus<T> *> buses, Optimizer optimizer, unsigned int seed);
 
 public:
-    Graph<T> &getGraph();
+    Graph<T, W, Direction> &getGraph();
     T &getGarageVertexId();
     std::vector<Bus<T>> &getBuses();
+    Fleet<T> &getFleet();
     std::vector<Company<T>> &getCompanies();
+    bool &getReportOptimalityGap();
 
     void loadTagsFile();
-
-    std::vector<Bus<T> *> getBusesForCompany(Company<T> company, string direction);
-    double distance(std::vector<Stop<T>> bus_stops, std::vector<Bus<T> *> buses,
-                    T company_vertex_id,
-                    std::unordered_map<std::pair<T, T>, double, pair_hash> *distances, string direction);
-    std::unordered_map<std::pair<T, T>, double, pair_hash> getBusStopsDistances(
-        T garage_vertex_id, std::vector<Stop<T>> bus_stops, T company_vertex_id, string direction);
-    double simulatedAnnealing(Company<T> company, string direction);
+    void openDistanceCache();
+    void saveDistanceCache();
+    void clear();
+
+    std::vector<T> getDisconnectedLocations(const Company<T> &company) const;
+    StopMatrix<T> getBusStopsDistances(T garage_vertex_id, std::vector<Stop<T>> bus_stops, T company_vertex_id,
+                                       unsigned int &disconnected) const;
+    RoutePlan<T> getInitialPlan(std::vector<Stop<T>> bus_stops, std::vector<Bus<T> *> buses,
+                                const StopMatrix<T> &distances, string direction) const;
+    typedef std::function<void(unsigned int, const CompanyPlan<T> &)> PlannedCallback;
+    std::vector<CompanyPlan<T>> planCompanies(Optimizer optimizer, PlannedCallback on_planned = nullptr);
+    void setBusesPaths(const TripPlan<T> &trip);
     void clearBusesPaths();
     void sortBusesAscendingCapacity();
 };
@@ -93,35 +149,87 @@ public:
 /**
  * .cpp
 */
-template <class T>
-Graph<T> &Manager<T>::getGraph()
+template <class T, class W, class Direction>
+Graph<T, W, Direction> &Manager<T, W, Direction>::getGraph()
 {
     return this->graph;
 }
 
-template <class T>
-T &Manager<T>::getGarageVertexId()
+template <class T, class W, class Direction>
+T &Manager<T, W, Direction>::getGarageVertexId()
 {
     return this->garage_vertex_id;
 }
 
-template <class T>
-std::vector<Bus<T>> &Manager<T>::getBuses()
+template <class T, class W, class Direction>
+std::vector<Bus<T>> &Manager<T, W, Direction>::getBuses()
 {
     return this->buses;
 }
 
-template <class T>
-std::vector<Company<T>> &Manager<T>::getCompanies()
+template <class T, class W, class Direction>
+Fleet<T> &Manager<T, W, Direction>::getFleet()
+{
+    return this->fleet;
+}
+
+template <class T, class W, class Direction>
+std::vector<Company<T>> &Manager<T, W, Direction>::getCompanies()
 {
     return this->companies;
 }
 
+template <class T, class W, class Direction>
+bool &Manager<T, W, Direction>::getReportOptimalityGap()
+{
+    return this->report_optimality_gap;
+}
+
+/**
+ * Opens the distance cache file of the loaded map, named after the checksum of the map files
+ */
+template <class T, class W, class Direction>
+void Manager<T, W, Direction>::openDistanceCache()
+{
+    if (graph.getChecksum() == 0)
+    {
+        return;
+    }
+    std::ostringstream filename;
+    filename << "resources/distances_" << std::hex << graph.getChecksum() << ".cache";
+    distance_cache.open(filename.str(), graph.getChecksum());
+}
+
+template <class T, class W, class Direction>
+void Manager<T, W, Direction>::saveDistanceCache()
+{
+    if (!distance_cache.save())
+    {
+        std::cout << "Unable to write the distance cache file" << std::endl;
+    }
+}
+
+/**
+ * Drops the map, its companies and the buses, so another map can be loaded.
+ * New distances of the map are saved first
+ */
+template <class T, class W, class Direction>
+void Manager<T, W, Direction>::clear()
+{
+    saveDistanceCache();
+    distance_cache.clear();
+    companies.clear();
+    buses.clear();
+    fleet.build(buses);
+    global_bus_id = 0;
+    graph.clear();
+}
+
 /**
  * Load companies, garage and bus stops vertices for 16x16 grid testing example
 */
-template <class T>
-void Manager<T>::loadTagsFile()
+template <class T, class W, class Direction>
+void Manager<T, W, Direction>::loadTagsFile()
 {
     std::string filename("resources/Mapas-20200424/GridGraphs/16x16/tags.txt");
     std::ifstream tags(filename);
@@ -184,361 +292,939 @@ void Manager<T>::loadTagsFile()
 }
 
 /************************* ALGORITHMS  **************************/
+
 template <class T>
-std::vector<Bus<T> *> Manager<T>::getBusesForCompany(Company<T> company, string direction)
+bool greater_capacity(const Bus<T> bus1, const Bus<T> bus2)
 {
-    std::vector<Bus<T> *> buses_for_company;
+    return bus1.capacity < bus2.capacity;
+}
 
-    if (direction == "company")
+double probability(double delta_distance, double temperature)
+{
+    /**
+     * probability function to decide wether to change the solution or not
+     * as delta distance decreases the probability is higher which means better solutions are favoured
+     * as temperature decreases the probability to change to a better solution is higher
+     * and the probability to change to a worse solution is lower 
+     * which means that as the temperature reaches 0 
+     * the algorithm will behave similar to hill climbing (only changing to better solutions)
+    */
+    return (1 / (1 + exp(delta_distance / temperature)));
+}
+
+/**
+ * Typical length change of a move of the plan: mean |delta| of up to num_samples random moves, not applied.
+ * Gives the annealing a temperature on the scale of the instance
+ */
+template <class T>
+double typicalMoveDelta(const RoutePlan<T> &plan, const StopMatrix<T> &distances, unsigned int num_samples)
+{
+    Move move;
+    double total = 0;
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < num_samples; i++)
     {
-        std::vector<Bus<T> *> aux_buses;
-        for (auto &bus : this->buses)
+        if (randomMove(plan, distances, move) && move.delta != INF)
         {
-            aux_buses.push_back(&bus);
+            total += fabs(move.delta);
+            count++;
         }
+    }
+    return count == 0 ? 0 : total / count;
+}
 
-        std::vector<Stop<T>> bus_stops = company.bus_stops;
+/**
+ * Simulated annealing over the routes of each bus: each iteration tries a random
+ * 2-opt, or-opt, relocate or cross-exchange move, whose length change is computed
+ * from the distance matrix without rebuilding the routes.
+ * The temperature starts at a fraction of the typical move length change (typicalMoveDelta),
+ * small when the plan is warm started (savings or last routes) so the search refines it instead
+ * of scrambling it, and falls geometrically to FINAL_TEMPERATURE of its start
+ */
+template <class T>
+void annealRoutes(RoutePlan<T> &plan, const StopMatrix<T> &distances, unsigned int num_iterations, bool warm_start = true)
+{
+    double r, prob;
+    Move move;
+
+    // keep the best plan found, the current one may be worse when the annealing stops
+    RoutePlan<T> best_plan = plan;
+    double current_distance = planLength(plan, distances), best_distance = current_distance;
 
-        // remove unavailable buses from vector
-        for (unsigned int i = 0; i < aux_buses.size(); i++)
+    // temperature initial value
+    double temperature = typicalMoveDelta(plan, distances, TEMPERATURE_SAMPLES) *
+                         (warm_start ? WARM_START_TEMPERATURE : COLD_START_TEMPERATURE);
+    if (temperature <= 0)
+    {
+        // every move keeps the length, nothing to improve
+        return;
+    }
+    double cooling_rate = pow(FINAL_TEMPERATURE, 1.0 / std::max(1u, num_iterations));
+
+    for (unsigned int i = 0; i < num_iterations; i++)
+    {
+        if (randomMove(plan, distances, move))
         {
-            if (!aux_buses[i]->path.empty())
+            r = randomProbability();
+            prob = probability(move.delta, temperature);
+            if (r <= prob)
             {
-                aux_buses.erase(aux_buses.begin() + i);
-                --i;
+                applyMove(plan, move);
+                current_distance += move.delta;
+                if (current_distance < best_distance - 1e-9)
+                {
+                    best_plan = plan;
+                    best_distance = current_distance;
+                }
             }
         }
+        temperature *= cooling_rate;
+    }
 
-        // get total number of workers
-        int number_of_workers = 0;
-        for (auto stop : bus_stops)
+    plan = best_plan;
+}
+
+/**
+ * Large neighbourhood search: each iteration removes a cluster of visits (ruinRoutes)
+ * and inserts them back at their cheapest positions (recreateRoutes).
+ * The new plan is kept if it is not longer than the current one
+ */
+template <class T>
+void ruinAndRecreateRoutes(RoutePlan<T> &plan, const StopMatrix<T> &distances, unsigned int num_iterations)
+{
+    double current_distance = planLength(plan, distances), new_distance;
+    RoutePlan<T> new_plan;
+
+    for (unsigned int i = 0; i < num_iterations; i++)
+    {
+        new_plan = plan;
+        std::vector<Visit<T>> removed = ruinRoutes(new_plan, distances);
+        if (!recreateRoutes(new_plan, removed, distances))
         {
-            number_of_workers += stop.number_of_workers;
+            continue;
         }
 
-        // get total capacity of all available buses
-        int total_capacity = 0;
-        for (auto bus : aux_buses)
+        new_distance = planLength(new_plan, distances);
+        if (new_distance != -1 && new_distance <= current_distance)
         {
-            total_capacity += bus->capacity;
+            plan = new_plan;
+            current_distance = new_distance;
         }
+    }
+}
 
-        // if available buses can provide the service
-        if (number_of_workers <= total_capacity)
+/**
+ * Runs task(0), ..., task(n - 1) as parallel tasks of the default thread pool
+ */
+template <class Function>
+void parallelFor(unsigned int n, Function task)
+{
+    TaskGroup group;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        group.run([&task, i]() { task(i); });
+    }
+    group.wait();
+}
+
+/**
+ * Buses of a trip that have a path
+ */
+template <class T>
+std::vector<Bus<T> *> usedBuses(const TripPlan<T> &trip)
+{
+    std::vector<Bus<T> *> used_buses;
+    for (unsigned int i = 0; i < trip.buses.size() && i < trip.paths.size(); i++)
+    {
+        if (!trip.paths[i].empty())
         {
-            // get minimum number of buses
-            while (number_of_workers > 0)
-            {
-                for (unsigned int i = 0; i < aux_buses.size(); i++)
-                {
-                    if (aux_buses[i]->capacity >= number_of_workers || i == aux_buses.size() - 1)
-                    {
-                        number_of_workers -= aux_buses[i]->capacity;
-                        buses_for_company.push_back(aux_buses[i]);
-                        aux_buses.erase(aux_buses.begin() + i);
-                        break;
-                    }
-                }
-            }
+            used_buses.push_back(trip.buses[i]);
         }
     }
-    else if (direction == "garage")
+    return used_buses;
+}
+
+/**
+ * Vertices visited by the bus of a route, empty if the bus is not used
+ */
+template <class T>
+std::vector<T> routePath(const RoutePlan<T> &plan, const BusRoute<T> &route, const StopMatrix<T> &distances)
+{
+    std::vector<T> path;
+    if (!route.visits.empty())
     {
-        for (auto &bus : this->buses)
+        path.push_back(distances.getVertexId(plan.start));
+        for (auto &visit : route.visits)
         {
-            if (!bus.path.empty())
+            // consecutive visits to the same split bus stop are a single stop
+            if (path.back() != distances.getVertexId(visit.stop))
             {
-                if (bus.path[0] == company.company_vertex_id ||
-                    bus.path[bus.path.size() - 1] == company.company_vertex_id)
-                {
-                    buses_for_company.push_back(&bus);
-                }
+                path.push_back(distances.getVertexId(visit.stop));
             }
         }
+        path.push_back(distances.getVertexId(plan.end));
     }
-
-    return buses_for_company;
+    return path;
 }
 
-template <class T>
-bool greater_capacity(const Bus<T> bus1, const Bus<T> bus2)
+/**
+ * Calculates the distances between all bus stops and the garage and company vertices.
+ * Bus stops take the first rows of the matrix, followed by the garage and the company.
+ * disconnected is set to the number of those locations with no road to or from the garage
+ */
+template <class T, class W, class Direction>
+StopMatrix<T> Manager<T, W, Direction>::getBusStopsDistances(T garage_vertex_id, std::vector<Stop<T>> bus_stops, T company_vertex_id,
+                                                             unsigned int &disconnected) const
 {
-    return bus1.capacity < bus2.capacity;
+    std::vector<T> vertices;
+    for (auto &stop : bus_stops)
+    {
+        vertices.push_back(stop.vertex_id);
+    }
+    vertices.push_back(garage_vertex_id);
+    vertices.push_back(company_vertex_id);
+
+    disconnected = 0;
+    for (T vertex : vertices)
+    {
+        if (!graph.areConnected(garage_vertex_id, vertex))
+        {
+            disconnected++;
+        }
+    }
+
+    StopMatrix<T> distances;
+    distances.build(graph, vertices, &distance_cache);
+    return distances;
 }
 
-double probability(double delta_distance, double temperature)
+/**
+ * Initial solution for the annealing, built with the Clarke-Wright savings heuristic
+ */
+template <class T, class W, class Direction>
+RoutePlan<T> Manager<T, W, Direction>::getInitialPlan(std::vector<Stop<T>> bus_stops, std::vector<Bus<T> *> buses,
+                                        const StopMatrix<T> &distances, string direction) const
 {
-    /**
-     * probability function to decide wether to change the solution or not
-     * as delta distance decreases the probability is higher which means better solutions are favoured
-     * as temperature decreases the probability to change to a better solution is higher
-     * and the probability to change to a worse solution is lower 
-     * which means that as the temperature reaches 0 
-     * the algorithm will behave similar to hill climbing (only changing to better solutions)
-    */
-    return (1 / (1 + exp(delta_distance / temperature)));
+    unsigned int garage_index = bus_stops.size(), company_index = bus_stops.size() + 1;
+
+    std::vector<Visit<T>> visits;
+    for (unsigned int i = 0; i < bus_stops.size(); i++)
+    {
+        visits.push_back({i, bus_stops[i].number_of_workers});
+    }
+
+    std::vector<T> capacities;
+    for (auto bus : buses)
+    {
+        capacities.push_back(bus->capacity);
+    }
+
+    if (direction == "company")
+    {
+        return savingsRoutes(garage_index, company_index, visits, capacities, distances);
+    }
+    return savingsRoutes(company_index, garage_index, visits, capacities, distances);
 }
 
-template <class T>
-std::vector<Stop<T>> randomNeighbour(std::vector<Stop<T>> bus_stops)
+/**
+ * Improves a plan with the given optimizer.
+ * A single bus with few bus stops is solved exactly with Held-Karp instead
+ */
+template <class T, class W, class Direction>
+void Manager<T, W, Direction>::optimizePlan(RoutePlan<T> &plan, const StopMatrix<T> &distances, Optimizer optimizer) const
 {
-    if (bus_stops.size() > 1)
+    // from the savings plan, 100000 iterations give 2 to 9% shorter plans than 20000 on 200 bus stops (benchmark.cpp),
+    // for about 10 ms
+    unsigned int num_iterations = 100000;
+    // each ruin and recreate iteration moves many stops at once
+    unsigned int num_lns_iterations = 1000;
+
+    if (plan.routes.size() == 1 && plan.routes[0].visits.size() <= MAX_EXACT_STOPS)
     {
-        unsigned int index1, index2;
-        do
+        RoutePlan<T> annealed_plan = plan;
+        double exact_distance = heldKarp(plan, plan.routes[0], distances);
+
+        if (this->report_optimality_gap)
         {
-            index1 = rand() % (bus_stops.size());
-            index2 = rand() % (bus_stops.size());
-        } while (index1 == index2);
-        std::swap(bus_stops[index1], bus_stops[index2]);
+            annealRoutes(annealed_plan, distances, num_iterations);
+            double annealed_distance = planLength(annealed_plan, distances);
+            std::cout << "Exact Distance: " << exact_distance << ", Annealing Distance: " << annealed_distance;
+            // every stop may coincide with the garage and the company
+            if (exact_distance > 0)
+            {
+                std::cout << " (gap " << (annealed_distance - exact_distance) / exact_distance * 100 << "%)";
+            }
+            std::cout << "\n";
+        }
+    }
+    else if (optimizer == RUIN_AND_RECREATE)
+    {
+        // starts from the annealed plan so it is never longer than the annealing alone;
+        // the ruin and recreate moves many visits at once, which pays off on companies with many bus stops
+        annealRoutes(plan, distances, num_iterations);
+        ruinAndRecreateRoutes(plan, distances, num_lns_iterations);
+    }
+    else
+    {
+        annealRoutes(plan, distances, num_iterations);
+    }
+}
+
+/**
+ * Brings the distance matrix kept by the company up to date with its bus stops, garage and location.
+ * Only the rows and columns of vertices that were not in the matrix are searched (StopMatrix::update)
+ */
+template <class T, class W, class Direction>
+const StopMatrix<T> &Manager<T, W, Direction>::updateBusStopsDistances(Company<T> &company) const
+{
+    std::vector<T> vertices;
+    for (auto &stop : company.bus_stops)
+    {
+        vertices.push_back(stop.vertex_id);
     }
+    vertices.push_back(this->garage_vertex_id);
+    vertices.push_back(company.company_vertex_id);
 
-    return bus_stops;
+    company.distances.update(graph, vertices, &distance_cache);
+    return company.distances;
 }
 
-template <class T>
-std::vector<vector<T>> getBusesPaths(std::vector<Stop<T>> bus_stops, std::vector<Bus<T> *> buses)
+/**
+ * Plans one trip of a company on its distance matrix (updateBusStopsDistances), starting from
+ * the shorter of the savings solution and the last routes of the company (warmStartRoutes).
+ * Only reads the manager, so trips of different companies can be planned in parallel
+ */
+template <class T, class W, class Direction>
+TripPlan<T> Manager<T, W, Direction>::planTrip(Company<T> &company, std::vector<Bus<T> *> buses, string direction, Optimizer optimizer) const
 {
-    vector<vector<T>> buses_paths;
+    TripPlan<T> trip;
+    trip.buses = buses;
 
-    // fill with empty vectors equal to the number of buses
-    for (unsigned int i = 0; i < buses.size(); i++)
+    const StopMatrix<T> &distances = company.distances;
+    std::vector<SavedRoute<T>> &saved = direction == "company" ? company.to_company_routes : company.to_garage_routes;
+
+    RoutePlan<T> plan = getInitialPlan(company.bus_stops, buses, distances, direction);
+    trip.distance = planLength(plan, distances);
+    if (trip.distance == -1)
     {
-        buses_paths.push_back(vector<T>());
+        // some bus stop can not be reached because of graph connectivity
+        trip.paths.resize(buses.size());
+        return trip;
     }
 
-    T bus_capacity;
-    for (unsigned int i = 0; i < buses.size(); i++)
+    if (!saved.empty())
     {
-        bus_capacity = buses[i]->capacity;
-        while (bus_capacity > 0)
+        std::vector<Visit<T>> visits;
+        for (unsigned int i = 0; i < company.bus_stops.size(); i++)
         {
-            bus_capacity -= bus_stops[0].number_of_workers;
-            buses_paths[i].push_back(bus_stops[0].vertex_id);
-            if (bus_capacity < 0)
-            {
-                bus_stops[0].number_of_workers = abs(bus_capacity);
-            }
-            else
-            {
-                bus_stops.erase(bus_stops.begin());
+            visits.push_back({i, company.bus_stops[i].number_of_workers});
+        }
+        std::vector<T> capacities;
+        for (auto bus : buses)
+        {
+            capacities.push_back(bus->capacity);
+        }
 
-                if (bus_stops.empty())
-                {
-                    break;
-                }
-            }
+        RoutePlan<T> warm_plan = warmStartRoutes(plan.start, plan.end, visits, capacities, saved, distances);
+        double warm_distance = warm_plan.routes.empty() ? -1 : planLength(warm_plan, distances);
+        if (warm_distance != -1 && warm_distance < trip.distance)
+        {
+            plan = warm_plan;
         }
     }
 
-    return buses_paths;
+    optimizePlan(plan, distances, optimizer);
+    trip.distance = planLength(plan, distances);
+    for (unsigned int i = 0; i < buses.size(); i++)
+    {
+        trip.paths.push_back(routePath(plan, plan.routes[i], distances));
+    }
+    trip.geometry = getPathsGeometry(trip.paths);
+    saved = saveRoutes(plan, distances);
+
+    return trip;
 }
 
-template <class T>
-double Manager<T>::distance(std::vector<Stop<T>> bus_stops, std::vector<Bus<T> *> buses, T company_vertex_id,
-                            std::unordered_map<std::pair<T, T>, double, pair_hash> *distances, string direction)
+/**
+ * Estimated length each bus adds to the routes of a company: a bus drives from the garage to its
+ * bus stops and on to the company, about the mean straight line distance from the garage to a bus stop
+ * plus from the bus stop to the company. Visiting the bus stops themselves costs about the same
+ * whatever the number of buses, so it is left out
+ */
+template <class T, class W, class Direction>
+double Manager<T, W, Direction>::estimateBusCost(const Company<T> &company) const
 {
-    double total_distance = 0;
+    int garage = graph.findVertexIndex(this->garage_vertex_id), destination = graph.findVertexIndex(company.company_vertex_id);
+    if (garage == -1 || destination == -1)
+    {
+        return 0;
+    }
 
-    vector<vector<T>> buses_paths = getBusesPaths(bus_stops, buses);
-    for (auto &path : buses_paths)
+    double total = 0;
+    unsigned int count = 0;
+    for (auto &stop : company.bus_stops)
     {
-        if (direction == "company")
+        int vertex = graph.findVertexIndex(stop.vertex_id);
+        if (vertex != -1)
         {
-            path.insert(path.begin(), this->garage_vertex_id);
-            path.push_back(company_vertex_id);
+            total += hypot(graph.getX(vertex) - graph.getX(garage), graph.getY(vertex) - graph.getY(garage)) +
+                     hypot(graph.getX(destination) - graph.getX(vertex), graph.getY(destination) - graph.getY(vertex));
+            count++;
         }
-        else if (direction == "garage")
-        {
-            path.insert(path.begin(), company_vertex_id);
-            path.push_back(this->garage_vertex_id);
-        }
-        for (unsigned int i = 0; i < path.size() - 1; i++)
+    }
+    return count == 0 ? 0 : total / count;
+}
+
+/**
+ * Gives the companies their buses in the given order on split_fleet (Fleet::allocate), each one
+ * keeping back the seats the companies after it need.
+ * Returns the number of companies with workers left without buses; cost is set to the estimated
+ * length the buses add to the routes (estimateBusCost of each company times its buses)
+ */
+template <class T, class W, class Direction>
+unsigned int Manager<T, W, Direction>::splitFleet(const std::vector<unsigned int> &order, const std::vector<T> &demands,
+                                                  const std::vector<double> &bus_costs, Fleet<T> &split_fleet,
+                                                  std::vector<std::vector<Bus<T> *>> &buses_for_companies, double &cost) const
+{
+    T remaining_demand = 0;
+    for (unsigned int i : order)
+    {
+        remaining_demand += demands[i];
+    }
+
+    unsigned int unserved = 0;
+    cost = 0;
+    buses_for_companies.assign(demands.size(), std::vector<Bus<T> *>());
+    for (unsigned int i : order)
+    {
+        remaining_demand -= demands[i];
+        split_fleet.releaseAll(i);
+        if (demands[i] > 0)
         {
-            // if distances map doesn't contain a certain value because of graph connectivity
-            if (distances->find({path[i], path[i + 1]}) == distances->end())
+            buses_for_companies[i] = split_fleet.allocate(i, demands[i], remaining_demand);
+            if (buses_for_companies[i].empty())
             {
-                return -1;
+                unserved++;
             }
-
-            total_distance += distances->at({path[i], path[i + 1]});
+            cost += bus_costs[i] * buses_for_companies[i].size();
         }
     }
-
-    return total_distance;
+    return unserved;
 }
 
 /**
- * Calculates and stores distances between bus stops and garage and company vertices
- * and stores them in an unordered map
+ * Splits the fleet between all the companies by their joint cost: every order of the companies
+ * (or, with more than MAX_SPLIT_ORDERS_COMPANIES companies, by decreasing cost per bus and by decreasing
+ * number of workers) is tried with splitFleet, and the split that serves the most companies with the
+ * shortest estimated length added by the buses is kept. Companies whose buses are far from the garage
+ * or the company are given bigger buses, so they need fewer of them.
+ * Enough seats in the whole fleet do not guarantee every company is served (buses 7, 7 and 6 for
+ * two companies of 10 workers); a company left without buses is reported
  */
-template <class T>
-std::unordered_map<std::pair<T, T>, double, pair_hash> Manager<T>::getBusStopsDistances(
-    T garage_vertex_id, std::vector<Stop<T>> bus_stops, T company_vertex_id, string direction)
+template <class T, class W, class Direction>
+std::vector<std::vector<Bus<T> *>> Manager<T, W, Direction>::allocateFleet()
 {
-    std::unordered_map<std::pair<T, T>, double, pair_hash> distances;
+    unsigned int n = companies.size();
+    std::vector<T> demands(n, 0);
+    std::vector<double> bus_costs(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        for (auto &stop : companies[i].bus_stops)
+        {
+            demands[i] += stop.number_of_workers;
+        }
+        bus_costs[i] = estimateBusCost(companies[i]);
+    }
 
-    double distance;
-    Vertex<T> *vertex;
+    std::vector<unsigned int> order(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        order[i] = i;
+    }
 
-    for (unsigned int i = 0; i < bus_stops.size(); i++)
+    std::vector<std::vector<unsigned int>> orders;
+    if (n <= MAX_SPLIT_ORDERS_COMPANIES)
     {
-        if (direction == "company")
+        do
         {
-            // calculate and store distances between garage and all bus stops
-            graph.dijkstraShortestPath(garage_vertex_id);
-            vertex = graph.findVertex(bus_stops[i].vertex_id);
-            distance = vertex->getDist();
+            orders.push_back(order);
+        } while (std::next_permutation(order.begin(), order.end()));
+    }
+    else
+    {
+        std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return bus_costs[a] > bus_costs[b]; });
+        orders.push_back(order);
+        std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return demands[a] > demands[b]; });
+        orders.push_back(order);
+    }
 
-            if (distance != INF)
-            {
-                distances[{garage_vertex_id, bus_stops[i].vertex_id}] = distance;
-            }
+    std::vector<std::vector<Bus<T> *>> buses_for_companies, split;
+    Fleet<T> best_fleet = fleet;
+    unsigned int best_unserved = std::numeric_limits<unsigned int>::max(), unserved;
+    double best_cost = INF, cost;
+    for (auto &split_order : orders)
+    {
+        Fleet<T> split_fleet = fleet;
+        unserved = splitFleet(split_order, demands, bus_costs, split_fleet, split, cost);
+        if (unserved < best_unserved || (unserved == best_unserved && cost < best_cost - 1e-9))
+        {
+            best_unserved = unserved;
+            best_cost = cost;
+            best_fleet = split_fleet;
+            buses_for_companies = split;
+        }
+    }
+    fleet = best_fleet;
 
-            // calculate and store distances between all bus stops and company
-            graph.dijkstraShortestPath(bus_stops[i].vertex_id);
-            vertex = graph.findVertex(company_vertex_id);
-            distance = vertex->getDist();
+    for (unsigned int i = 0; i < n; i++)
+    {
+        if (demands[i] > 0 && buses_for_companies[i].empty())
+        {
+            std::cout << "Warning: not enough buses left for " << companies[i].name << ", " << fleet.getAvailableCapacity()
+                      << " seats for " << demands[i] << " workers\n";
+        }
+    }
 
-            if (distance != INF)
-            {
-                distances[{bus_stops[i].vertex_id, company_vertex_id}] = distance;
-            }
+    return buses_for_companies;
+}
+
+/**
+ * The company and bus stops with no road to or from the garage, found without any search (Graph::areConnected)
+ */
+template <class T, class W, class Direction>
+std::vector<T> Manager<T, W, Direction>::getDisconnectedLocations(const Company<T> &company) const
+{
+    std::vector<T> disconnected;
+    if (!graph.areConnected(this->garage_vertex_id, company.company_vertex_id))
+    {
+        disconnected.push_back(company.company_vertex_id);
+    }
+    for (auto &stop : company.bus_stops)
+    {
+        if (!graph.areConnected(this->garage_vertex_id, stop.vertex_id))
+        {
+            disconnected.push_back(stop.vertex_id);
         }
-        else if (direction == "garage")
+    }
+    return disconnected;
+}
+
+/**
+ * Contracts the chains of shape vertices of the graph (Graph::contractChains), keeping the garage,
+ * the companies and their bus stops, so the searches of the planner run on a smaller graph.
+ * The contraction is kept while all those vertices are still kept by it
+ */
+template <class T, class W, class Direction>
+void Manager<T, W, Direction>::contractGraph()
+{
+    std::vector<T> kept;
+    kept.push_back(this->garage_vertex_id);
+    for (auto &company : companies)
+    {
+        kept.push_back(company.company_vertex_id);
+        for (auto &stop : company.bus_stops)
         {
-            // calculate and store distances between garage and all bus stops
-            graph.dijkstraShortestPath(bus_stops[i].vertex_id);
-            vertex = graph.findVertex(garage_vertex_id);
-            distance = vertex->getDist();
+            kept.push_back(stop.vertex_id);
+        }
+    }
 
-            if (distance != INF)
-            {
-                distances[{bus_stops[i].vertex_id, garage_vertex_id}] = distance;
-            }
+    if (graph.isContracted())
+    {
+        bool all_kept = true;
+        for (T vertex_id : kept)
+        {
+            all_kept = all_kept && graph.isCoreVertex(vertex_id);
+        }
+        if (all_kept)
+        {
+            return;
+        }
+    }
+    graph.contractChains(kept);
+}
 
-            // calculate and store distances between all bus stops and company
-            graph.dijkstraShortestPath(company_vertex_id);
-            vertex = graph.findVertex(bus_stops[i].vertex_id);
-            distance = vertex->getDist();
+/**
+ * Checks in constant time per bus stop if the garage, the company and all its bus stops are in the
+ * same strongly connected component, which both trips need. Graph::updateComponents must be up to date
+ */
+template <class T, class W, class Direction>
+bool Manager<T, W, Direction>::areStopsReachable(const Company<T> &company) const
+{
+    if (!graph.areStronglyConnected(this->garage_vertex_id, company.company_vertex_id))
+    {
+        return false;
+    }
+    for (auto &stop : company.bus_stops)
+    {
+        if (!graph.areStronglyConnected(this->garage_vertex_id, stop.vertex_id))
+        {
+            return false;
+        }
+    }
+    return true;
+}
 
-            if (distance != INF)
+/**
+ * Every vertex driven through by each bus, following the shortest path of each leg of its path,
+ * so the routes can be drawn without searching. Runs one search per distinct leg origin,
+ * as parallel tasks, each stopping at the ends of its legs
+ */
+template <class T, class W, class Direction>
+std::vector<std::vector<T>> Manager<T, W, Direction>::getPathsGeometry(const std::vector<std::vector<T>> &paths) const
+{
+    // legs grouped by origin
+    std::vector<T> origins;
+    std::unordered_map<T, unsigned int> origin_of_vertex;
+    std::vector<std::vector<T>> targets;
+    for (const std::vector<T> &path : paths)
+    {
+        for (unsigned int i = 0; i + 1 < path.size(); i++)
+        {
+            auto it = origin_of_vertex.find(path[i]);
+            if (it == origin_of_vertex.end())
             {
-                distances[{company_vertex_id, bus_stops[i].vertex_id}] = distance;
+                it = origin_of_vertex.insert({path[i], origins.size()}).first;
+                origins.push_back(path[i]);
+                targets.push_back(std::vector<T>());
             }
+            targets[it->second].push_back(path[i + 1]);
         }
+    }
 
-        unsigned int aux_index = i + 1;
-        while (aux_index < bus_stops.size())
+    std::vector<std::vector<std::vector<T>>> legs(origins.size());
+    parallelFor(origins.size(), [&](unsigned int o) {
+        std::vector<unsigned int> target_indices;
+        for (T target : targets[o])
         {
-            // calculate and store distances between bus stops
-            graph.dijkstraShortestPath(bus_stops[i].vertex_id);
-            vertex = graph.findVertex(bus_stops[aux_index].vertex_id);
-            distance = vertex->getDist();
+            target_indices.push_back(graph.findVertexIndex(target));
+        }
+        typename Graph<T, W, Direction>::Paths shortest_paths;
+        graph.dijkstraShortestPath(graph.findVertexIndex(origins[o]), shortest_paths, target_indices);
+        for (unsigned int target_index : target_indices)
+        {
+            legs[o].push_back(graph.getPathTo(target_index, shortest_paths));
+        }
+    });
 
-            if (distance != INF)
-            {
-                distances[{bus_stops[i].vertex_id, bus_stops[aux_index].vertex_id}] = distance;
-            }
+    std::vector<std::vector<T>> geometry(paths.size());
+    for (unsigned int p = 0; p < paths.size(); p++)
+    {
+        for (unsigned int i = 0; i + 1 < paths[p].size(); i++)
+        {
+            unsigned int o = origin_of_vertex[paths[p][i]];
+            unsigned int t = std::find(targets[o].begin(), targets[o].end(), paths[p][i + 1]) - targets[o].begin();
+            const std::vector<T> &leg = legs[o][t];
+            // each leg starts where the one before ends
+            geometry[p].insert(geometry[p].end(), leg.begin() + (geometry[p].empty() || leg.empty() ? 0 : 1), leg.end());
+        }
+    }
 
-            graph.dijkstraShortestPath(bus_stops[aux_index].vertex_id);
-            vertex = graph.findVertex(bus_stops[i].vertex_id);
-            distance = vertex->getDist();
+    return geometry;
+}
 
-            if (distance != INF)
-            {
-                distances[{bus_stops[aux_index].vertex_id, bus_stops[i].vertex_id}] = distance;
-            }
+/**
+ * Plans one trip of a company with planClusters
+ */
+template <class T, class W, class Direction>
+TripPlan<T> Manager<T, W, Direction>::planClusterTrip(const Company<T> &company, std::vector<Bus<T> *> buses, string direction)
+{
+    TripPlan<T> trip;
+    trip.buses = buses;
+    trip.distance = planClusters(company, buses, direction, trip.warnings);
+    for (Bus<T> *bus : buses)
+    {
+        trip.paths.push_back(bus->path);
+    }
+    if (trip.distance != -1)
+    {
+        trip.geometry = getPathsGeometry(trip.paths);
+    }
+    return trip;
+}
+
+/**
+ * Plans both trips of a company with the buses it was given. The distance matrix is shared by both trips
+ * and the evening trip uses only the buses that took the workers to the company.
+ * The random generator is seeded right before each trip, so the result does not depend on the tasks
+ * this thread ran before
+ */
+template <class T, class W, class Direction>
+CompanyPlan<T> Manager<T, W, Direction>::planCompany(Company<T> &company, std::vector<Bus<T> *> buses, Optimizer optimizer, unsigned int seed)
+{
+    CompanyPlan<T> plan;
+
+    if (!areStopsReachable(company))
+    {
+        // some bus stop can not be reached because of graph connectivity
+        plan.to_company.buses = buses;
+        plan.to_company.paths.resize(buses.size());
+        plan.to_company.distance = -1;
+        return plan;
+    }
 
-            ++aux_index;
+    if (optimizer == CLUSTER_FIRST || company.bus_stops.size() > MAX_MATRIX_STOPS)
+    {
+        randomGenerator().seed(seed);
+        plan.to_company = planClusterTrip(company, buses, "company");
+        if (plan.to_company.distance != -1)
+        {
+            randomGenerator().seed(seed + 1);
+            plan.to_garage = planClusterTrip(company, usedBuses(plan.to_company), "garage");
         }
+        return plan;
     }
 
-    return distances;
+    updateBusStopsDistances(company);
+    randomGenerator().seed(seed);
+    plan.to_company = planTrip(company, buses, "company", optimizer);
+    if (plan.to_company.distance != -1)
+    {
+        randomGenerator().seed(seed + 1);
+        plan.to_garage = planTrip(company, usedBuses(plan.to_company), "garage", optimizer);
+    }
+    return plan;
 }
 
-template <class T>
-double Manager<T>::simulatedAnnealing(Company<T> company, string direction)
+/**
+ * Batch planner: splits the fleet between all companies (allocateFleet) and plans each company
+ * as a task of the default thread pool. A company task builds its distance matrix with nested
+ * shortest path tasks and then optimizes, so building the matrices of some companies overlaps
+ * with optimizing others.
+ * on_planned is called on the calling thread with each finished company, in company order,
+ * as soon as it and the ones before it are planned.
+ * Each company uses a fixed random seed, so the result is always the same for the same input
+ */
+template <class T, class W, class Direction>
+std::vector<CompanyPlan<T>> Manager<T, W, Direction>::planCompanies(Optimizer optimizer, PlannedCallback on_planned)
 {
     std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
 
-    unsigned int num_iterations = 100000;
-    double temperature_decrease_rate = 0.01;
-    double temperature, delta_distance;
-    std::vector<Stop<T>> bus_stops;
-    std::vector<Stop<T>> new_bus_stops;
-    double r, prob;
-    double current_distance = 0, new_distance = 0;
-    std::unordered_map<std::pair<T, T>, double, pair_hash> distances;
+    clearBusesPaths();
+    graph.updateComponents();
+    contractGraph();
+    std::vector<std::vector<Bus<T> *>> buses_for_companies = allocateFleet();
+    unsigned int n = companies.size();
+    std::vector<CompanyPlan<T>> plans(n);
+    std::vector<std::unique_ptr<TaskGroup>> tasks(n);
 
-    std::vector<Bus<T> *> buses_for_company = getBusesForCompany(company, direction);
-    if (buses_for_company.empty())
+    for (unsigned int i = 0; i < n; i++)
     {
-        std::cout << "Not enough buses to provide transportation to " << company.name << " workers\n";
+        if (buses_for_companies[i].empty())
+        {
+            continue;
+        }
+        tasks[i].reset(new TaskGroup());
+        tasks[i]->run([this, &plans, &buses_for_companies, optimizer, i]() {
+            plans[i] = planCompany(companies[i], buses_for_companies[i], optimizer, 2 * i + 1);
+        });
     }
-    else
+
+    // streams the finished companies, in order, to on_planned
+    for (unsigned int i = 0; i < n; i++)
     {
-        bus_stops = company.bus_stops;
-        distances = getBusStopsDistances(this->garage_vertex_id, bus_stops, company.company_vertex_id, direction);
-        current_distance = distance(bus_stops, buses_for_company, company.company_vertex_id, &distances, direction);
-        // temperature initial value
-        temperature = num_iterations * temperature_decrease_rate;
-        for (unsigned int i = 0; i < num_iterations; i++)
+        if (tasks[i])
         {
-            new_bus_stops = randomNeighbour(bus_stops);
-            new_distance = distance(new_bus_stops, buses_for_company, company.company_vertex_id, &distances, direction);
-            if (new_distance != -1)
+            tasks[i]->wait();
+        }
+        if (on_planned)
+        {
+            on_planned(i, plans[i]);
+        }
+    }
+
+    saveDistanceCache();
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    std::cout << "Duration = " << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1000000.0 << "[s]" << std::endl;
+
+    return plans;
+}
+
+/**
+ * Sets the path of each bus of a trip
+ */
+template <class T, class W, class Direction>
+void Manager<T, W, Direction>::setBusesPaths(const TripPlan<T> &trip)
+{
+    for (unsigned int i = 0; i < trip.buses.size() && i < trip.paths.size(); i++)
+    {
+        trip.buses[i]->path = trip.paths[i];
+        trip.buses[i]->geometry = i < trip.geometry.size() ? trip.geometry[i] : std::vector<T>();
+    }
+}
+
+/**
+ * Sweep clustering: sorts the bus stops by their angle around the company and splits them,
+ * in that order, in groups that fill the capacity of each bus (a bus stop may be split between two groups).
+ * The sweep starts after the largest angular gap between bus stops, so no cluster crosses it.
+ * The workers left once every bus is full are returned in unserved
+ */
+template <class T, class W, class Direction>
+std::vector<std::vector<Stop<T>>> Manager<T, W, Direction>::getClusters(const Company<T> &company, std::vector<Bus<T> *> buses,
+                                                                        std::vector<Stop<T>> &unserved)
+{
+    unsigned int center = graph.findVertexIndex(company.company_vertex_id);
+    std::vector<std::pair<double, Stop<T>>> stops_by_angle;
+    for (auto &stop : company.bus_stops)
+    {
+        unsigned int vertex = graph.findVertexIndex(stop.vertex_id);
+        stops_by_angle.push_back({atan2(graph.getY(vertex) - graph.getY(center), graph.getX(vertex) - graph.getX(center)), stop});
+    }
+    std::sort(stops_by_angle.begin(), stops_by_angle.end(),
+              [](const std::pair<double, Stop<T>> &a, const std::pair<double, Stop<T>> &b) { return a.first < b.first; });
+
+    unsigned int first = 0;
+    double largest_gap = 0;
+    for (unsigned int i = 0; i < stops_by_angle.size(); i++)
+    {
+        double gap = i == 0 ? stops_by_angle[0].first + 2 * M_PI - stops_by_angle.back().first
+                            : stops_by_angle[i].first - stops_by_angle[i - 1].first;
+        if (gap > largest_gap)
+        {
+            largest_gap = gap;
+            first = i;
+        }
+    }
+    std::rotate(stops_by_angle.begin(), stops_by_angle.begin() + first, stops_by_angle.end());
+
+    std::vector<std::vector<Stop<T>>> clusters(buses.size());
+    unsigned int next = 0;
+    for (unsigned int i = 0; i < buses.size(); i++)
+    {
+        T free_seats = buses[i]->capacity;
+        while (free_seats > 0 && next < stops_by_angle.size())
+        {
+            Stop<T> &stop = stops_by_angle[next].second;
+            T workers = std::min(stop.number_of_workers, free_seats);
+            clusters[i].push_back({stop.vertex_id, workers});
+            free_seats -= workers;
+            stop.number_of_workers -= workers;
+            if (stop.number_of_workers == 0)
             {
-                delta_distance = new_distance - current_distance;
-                r = ((double)rand() / (RAND_MAX));
-                prob = probability(delta_distance, temperature);
-                if (r <= prob)
-                {
-                    bus_stops = new_bus_stops;
-                    current_distance = new_distance;
-                }
+                ++next;
             }
-            temperature -= temperature_decrease_rate;
         }
     }
 
-    // attribute paths to buses
-    std::vector<vector<T>> buses_paths = getBusesPaths(bus_stops, buses_for_company);
-    for (unsigned int i = 0; i < buses_for_company.size(); i++)
+    unserved.clear();
+    for (; next < stops_by_angle.size(); next++)
+    {
+        unserved.push_back(stops_by_angle[next].second);
+    }
+
+    return clusters;
+}
+
+/**
+ * Cluster-first, route-second: gives each bus one cluster of bus stops (getClusters) and plans
+ * each cluster as an independent single bus route, in parallel. Only the small matrices of each
+ * cluster are built, so companies with thousands of bus stops fit in time and memory.
+ * Bus stops that do not fit in the buses and locations with no road to the garage are added to warnings,
+ * not printed, since the clusters and the companies are planned in parallel
+ */
+template <class T, class W, class Direction>
+double Manager<T, W, Direction>::planClusters(const Company<T> &company, std::vector<Bus<T> *> buses, string direction,
+                                              std::vector<std::string> &warnings)
+{
+    unsigned int num_iterations = 20000;
+    std::vector<Stop<T>> unserved;
+    std::vector<std::vector<Stop<T>>> clusters = getClusters(company, buses, unserved);
+    if (!unserved.empty())
+    {
+        T unserved_workers = 0;
+        for (auto &stop : unserved)
+        {
+            unserved_workers += stop.number_of_workers;
+        }
+        warnings.push_back("Warning: " + std::to_string(unserved_workers) + " workers of " + std::to_string(unserved.size()) +
+                           " bus stops do not fit in the buses and are not served");
+    }
+    std::vector<StopMatrix<T>> distances(clusters.size());
+    std::vector<unsigned int> disconnected(clusters.size(), 0);
+    std::vector<RoutePlan<T>> plans(clusters.size());
+    std::vector<unsigned int> seeds(clusters.size());
+
+    // drawn before any task runs, so waiting for tasks does not change the seeds
+    for (unsigned int i = 0; i < clusters.size(); i++)
     {
-        if (direction == "company")
+        seeds[i] = randomGenerator()();
+    }
+
+    parallelFor(clusters.size(), [&](unsigned int i) {
+        if (clusters[i].empty())
+        {
+            return;
+        }
+        distances[i] = getBusStopsDistances(this->garage_vertex_id, clusters[i], company.company_vertex_id, disconnected[i]);
+        plans[i] = getInitialPlan(clusters[i], {buses[i]}, distances[i], direction);
+        if (planLength(plans[i], distances[i]) == -1)
+        {
+            return;
+        }
+        randomGenerator().seed(seeds[i]);
+        if (plans[i].routes[0].visits.size() <= MAX_EXACT_STOPS)
         {
-            buses_paths[i].insert(buses_paths[i].begin(), this->garage_vertex_id);
-            buses_paths[i].push_back(company.company_vertex_id);
+            heldKarp(plans[i], plans[i].routes[0], distances[i]);
         }
-        else if (direction == "garage")
+        else
         {
-            buses_paths[i].insert(buses_paths[i].begin(), company.company_vertex_id);
-            buses_paths[i].push_back(this->garage_vertex_id);
+            annealRoutes(plans[i], distances[i], num_iterations);
         }
+    });
 
-        buses_for_company[i]->path = buses_paths[i];
+    unsigned int total_disconnected = 0;
+    for (unsigned int count : disconnected)
+    {
+        total_disconnected += count;
+    }
+    if (total_disconnected > 0)
+    {
+        warnings.push_back("Warning: " + std::to_string(total_disconnected) + " locations have no road to or from the garage");
     }
 
-    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double total_distance = 0, distance;
+    for (unsigned int i = 0; i < clusters.size(); i++)
+    {
+        if (clusters[i].empty())
+        {
+            buses[i]->path.clear();
+            continue;
+        }
+        distance = planLength(plans[i], distances[i]);
+        if (distance == -1)
+        {
+            // some bus stop can not be reached because of graph connectivity
+            return distance;
+        }
+        total_distance += distance;
+    }
 
-    std::cout << "Duration = " << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1000000.0 << "[s]" << std::endl;
+    for (unsigned int i = 0; i < clusters.size(); i++)
+    {
+        if (!clusters[i].empty())
+        {
+            buses[i]->path = routePath(plans[i], plans[i].routes[0], distances[i]);
+        }
+    }
 
-    return current_distance;
+    return total_distance;
 }
 
-template <class T>
-void Manager<T>::clearBusesPaths()
+template <class T, class W, class Direction>
+void Manager<T, W, Direction>::clearBusesPaths()
 {
     // re-initialize buses
     for (Bus<T> &bus : buses)
     {
         bus.path.clear();
+        bus.geometry.clear();
     }
+    fleet.build(buses);
 }
 
-template <class T>
-void Manager<T>::sortBusesAscendingCapacity()
+template <class T, class W, class Direction>
+void Manager<T, W, Direction>::sortBusesAscendingCapacity()
 {
     // sort buses in ascending order of capacity
     std::sort(buses.begin(), buses.end(), greater_capacity<T>);
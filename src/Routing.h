@@ -0,0 +1,959 @@
+/*
+ * Routing.h
+ */
+#ifndef ROUTING_H_
+#define ROUTING_H_
+
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+
+#include "StopMatrix.h"
+
+/************************* Visit  **************************/
+template <class T>
+struct Visit
+{
+    unsigned int stop; // row of the bus stop in the StopMatrix
+    T workers;         // workers picked up (a stop may be split between buses)
+};
+
+/************************* BusRoute  **************************/
+template <class T>
+struct BusRoute
+{
+    T capacity;
+    T load = 0;
+    std::vector<Visit<T>> visits;
+};
+
+/************************* RoutePlan  **************************/
+
+/**
+ * Routes of all the buses of one trip. Every route leaves from start and finishes at end
+ * (StopMatrix rows); a route without visits means the bus is not used and has length 0
+ */
+template <class T>
+struct RoutePlan
+{
+    unsigned int start;
+    unsigned int end;
+    std::vector<BusRoute<T>> routes;
+};
+
+/************************* SavedRoute  **************************/
+
+/**
+ * Route of a finished plan by vertex id, so it stays valid when the bus stops of the company
+ * (and so the StopMatrix rows) change. Used to warm start the next plan (warmStartRoutes)
+ */
+template <class T>
+struct SavedRoute
+{
+    T capacity;
+    std::vector<T> stops; // vertex ids of the bus stops, in visiting order
+};
+
+/************************* Move  **************************/
+enum MoveType
+{
+    TWO_OPT,       // reverse a segment of a route
+    OR_OPT,        // move a segment of up to 3 visits to another position of the same route
+    RELOCATE,      // move one visit to another route
+    CROSS_EXCHANGE // swap segments of up to 3 visits between two routes
+};
+
+struct Move
+{
+    MoveType type;
+    unsigned int route1, route2;       // routes involved
+    unsigned int position1, position2; // first visit of each segment or insertion position
+    unsigned int length1, length2;     // length of each segment
+    double delta;                      // change of the plan length if the move is applied
+};
+
+#define MAX_SEGMENT_LENGTH 3
+
+// fraction of the visits removed at most by ruinRoutes
+#define RUIN_FRACTION 0.3
+
+// largest number of bus stops solved exactly by heldKarp (2^15 * 15 table entries)
+#define MAX_EXACT_STOPS 15
+
+/**
+ * .cpp
+*/
+
+/**
+ * Random generator of the calling thread. The optimizers may run in several threads at once,
+ * each one seeds its own generator so the result does not depend on the threads scheduling
+ */
+inline std::mt19937 &randomGenerator()
+{
+    thread_local std::mt19937 generator(rand());
+    return generator;
+}
+
+/**
+ * Random integer in [0, n[
+ */
+inline unsigned int randomIndex(unsigned int n)
+{
+    return randomGenerator()() % n;
+}
+
+/**
+ * Random real number in [0, 1]
+ */
+inline double randomProbability()
+{
+    return (double)randomGenerator()() / std::mt19937::max();
+}
+
+/**
+ * Node (StopMatrix row) right before the gap "gap" of a route, gap 0 being the start of the trip
+ */
+template <class T>
+unsigned int previousNode(const RoutePlan<T> &plan, const BusRoute<T> &route, unsigned int gap)
+{
+    return gap == 0 ? plan.start : route.visits[gap - 1].stop;
+}
+
+/**
+ * Node (StopMatrix row) right after the gap "gap" of a route, the last gap being the end of the trip
+ */
+template <class T>
+unsigned int nextNode(const RoutePlan<T> &plan, const BusRoute<T> &route, unsigned int gap)
+{
+    return gap == route.visits.size() ? plan.end : route.visits[gap].stop;
+}
+
+template <class T>
+double routeLength(const RoutePlan<T> &plan, const BusRoute<T> &route, const StopMatrix<T> &matrix)
+{
+    if (route.visits.empty())
+    {
+        return 0;
+    }
+
+    double length = 0;
+    unsigned int node = plan.start;
+    for (const Visit<T> &visit : route.visits)
+    {
+        if (matrix.at(node, visit.stop) == INF)
+        {
+            return INF;
+        }
+        length += matrix.at(node, visit.stop);
+        node = visit.stop;
+    }
+
+    if (matrix.at(node, plan.end) == INF)
+    {
+        return INF;
+    }
+    return length + matrix.at(node, plan.end);
+}
+
+/**
+ * Total length of all routes, -1 if some route uses a pair of vertices that are not connected
+ */
+template <class T>
+double planLength(const RoutePlan<T> &plan, const StopMatrix<T> &matrix)
+{
+    double length = 0, route_length;
+    for (const BusRoute<T> &route : plan.routes)
+    {
+        route_length = routeLength(plan, route, matrix);
+        if (route_length == INF)
+        {
+            return -1;
+        }
+        length += route_length;
+    }
+    return length;
+}
+
+/**
+ * Splits the visits, in order, between buses with the given capacities,
+ * filling each bus before moving on to the next one (a visit may be split between two buses)
+ */
+template <class T>
+RoutePlan<T> fillRoutes(unsigned int start, unsigned int end, std::vector<Visit<T>> visits, const std::vector<T> &capacities)
+{
+    RoutePlan<T> plan;
+    plan.start = start;
+    plan.end = end;
+
+    unsigned int next = 0;
+    for (T capacity : capacities)
+    {
+        BusRoute<T> route;
+        route.capacity = capacity;
+        while (route.load < capacity && next < visits.size())
+        {
+            T workers = std::min(visits[next].workers, capacity - route.load);
+            route.visits.push_back({visits[next].stop, workers});
+            route.load += workers;
+            visits[next].workers -= workers;
+            if (visits[next].workers == 0)
+            {
+                ++next;
+            }
+        }
+        plan.routes.push_back(route);
+    }
+
+    return plan;
+}
+
+/************************* Saving  **************************/
+struct Saving
+{
+    double value;       // length saved by joining the two routes
+    unsigned int first; // visit at the end of the first route
+    unsigned int second; // visit at the start of the second route
+
+    bool operator<(const Saving &saving) const
+    {
+        return value > saving.value;
+    }
+};
+
+/**
+ * Clarke-Wright savings construction. Starts with one route per visit and joins the route ending
+ * at visit i with the route starting at visit j by decreasing order of
+ * saving(i, j) = d(i, end) + d(start, j) - d(i, j), while the load fits the largest bus.
+ * The routes are then given to the buses (biggest load first, to the smallest bus that fits it);
+ * if they do not fit the buses, the routes are concatenated and split by fillRoutes instead
+ */
+template <class T>
+RoutePlan<T> savingsRoutes(unsigned int start, unsigned int end, std::vector<Visit<T>> visits,
+                           const std::vector<T> &capacities, const StopMatrix<T> &matrix)
+{
+    T max_capacity = *std::max_element(capacities.begin(), capacities.end());
+
+    // visits with more workers than the largest bus are split beforehand
+    std::vector<Visit<T>> split_visits;
+    for (Visit<T> visit : visits)
+    {
+        while (visit.workers > max_capacity)
+        {
+            split_visits.push_back({visit.stop, max_capacity});
+            visit.workers -= max_capacity;
+        }
+        split_visits.push_back(visit);
+    }
+    visits = split_visits;
+    unsigned int n = visits.size();
+
+    // one route per visit
+    std::vector<std::vector<unsigned int>> routes(n);
+    std::vector<T> loads(n);
+    std::vector<unsigned int> route_of(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        routes[i].push_back(i);
+        loads[i] = visits[i].workers;
+        route_of[i] = i;
+    }
+
+    std::vector<Saving> savings;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        for (unsigned int j = 0; j < n; j++)
+        {
+            double between = matrix.at(visits[i].stop, visits[j].stop);
+            if (i == j || between == INF || matrix.at(visits[i].stop, end) == INF || matrix.at(start, visits[j].stop) == INF)
+            {
+                continue;
+            }
+            double value = matrix.at(visits[i].stop, end) + matrix.at(start, visits[j].stop) - between;
+            if (value > 0)
+            {
+                savings.push_back({value, i, j});
+            }
+        }
+    }
+    std::sort(savings.begin(), savings.end());
+
+    for (const Saving &saving : savings)
+    {
+        unsigned int a = route_of[saving.first], b = route_of[saving.second];
+        if (a == b || routes[a].back() != saving.first || routes[b].front() != saving.second ||
+            loads[a] + loads[b] > max_capacity)
+        {
+            continue;
+        }
+        for (unsigned int visit : routes[b])
+        {
+            routes[a].push_back(visit);
+            route_of[visit] = a;
+        }
+        loads[a] += loads[b];
+        routes[b].clear();
+        loads[b] = 0;
+    }
+
+    // non empty routes by decreasing load
+    std::vector<unsigned int> order;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        if (!routes[i].empty())
+        {
+            order.push_back(i);
+        }
+    }
+    std::sort(order.begin(), order.end(), [&loads](unsigned int a, unsigned int b) { return loads[a] > loads[b]; });
+
+    RoutePlan<T> plan;
+    plan.start = start;
+    plan.end = end;
+    for (T capacity : capacities)
+    {
+        BusRoute<T> route;
+        route.capacity = capacity;
+        plan.routes.push_back(route);
+    }
+
+    bool assigned = true;
+    for (unsigned int i : order)
+    {
+        int best_bus = -1;
+        for (unsigned int bus = 0; bus < capacities.size(); bus++)
+        {
+            if (plan.routes[bus].visits.empty() && capacities[bus] >= loads[i] &&
+                (best_bus == -1 || capacities[bus] < capacities[best_bus]))
+            {
+                best_bus = bus;
+            }
+        }
+        if (best_bus == -1)
+        {
+            assigned = false;
+            break;
+        }
+        for (unsigned int visit : routes[i])
+        {
+            plan.routes[best_bus].visits.push_back(visits[visit]);
+        }
+        plan.routes[best_bus].load = loads[i];
+    }
+
+    // keep the order of the savings routes but let fillRoutes split them between the buses
+    std::vector<Visit<T>> sequence;
+    for (unsigned int i : order)
+    {
+        for (unsigned int visit : routes[i])
+        {
+            sequence.push_back(visits[visit]);
+        }
+    }
+    RoutePlan<T> filled_plan = fillRoutes(start, end, sequence, capacities);
+
+    if (!assigned || planLength(plan, matrix) == -1 ||
+        (planLength(filled_plan, matrix) != -1 && planLength(filled_plan, matrix) < planLength(plan, matrix)))
+    {
+        return filled_plan;
+    }
+    return plan;
+}
+
+template <class T>
+bool twoOptMove(const RoutePlan<T> &plan, const StopMatrix<T> &matrix, Move &move)
+{
+    move.type = TWO_OPT;
+    move.route1 = move.route2 = randomIndex(plan.routes.size());
+    const std::vector<Visit<T>> &visits = plan.routes[move.route1].visits;
+    if (visits.size() < 2)
+    {
+        return false;
+    }
+
+    unsigned int i = randomIndex(visits.size()), j = randomIndex(visits.size());
+    if (i == j)
+    {
+        return false;
+    }
+    if (i > j)
+    {
+        std::swap(i, j);
+    }
+    move.position1 = i;
+    move.length1 = j - i + 1;
+
+    const BusRoute<T> &route = plan.routes[move.route1];
+    unsigned int prev = previousNode(plan, route, i), next = nextNode(plan, route, j + 1);
+    double added_in = matrix.at(prev, visits[j].stop), added_out = matrix.at(visits[i].stop, next);
+    if (added_in == INF || added_out == INF)
+    {
+        return false;
+    }
+    move.delta = added_in + added_out - matrix.at(prev, visits[i].stop) - matrix.at(visits[j].stop, next);
+
+    // on asymmetric distances the legs inside the segment change too: O(segment)
+    if (!matrix.isSymmetric())
+    {
+        for (unsigned int k = i; k < j; k++)
+        {
+            double reversed = matrix.at(visits[k + 1].stop, visits[k].stop);
+            if (reversed == INF)
+            {
+                return false;
+            }
+            move.delta += reversed - matrix.at(visits[k].stop, visits[k + 1].stop);
+        }
+    }
+
+    return true;
+}
+
+template <class T>
+bool orOptMove(const RoutePlan<T> &plan, const StopMatrix<T> &matrix, Move &move)
+{
+    move.type = OR_OPT;
+    move.route1 = move.route2 = randomIndex(plan.routes.size());
+    const BusRoute<T> &route = plan.routes[move.route1];
+    const std::vector<Visit<T>> &visits = route.visits;
+    unsigned int n = visits.size();
+    if (n < 2)
+    {
+        return false;
+    }
+
+    unsigned int length = 1 + randomIndex(std::min<unsigned int>(MAX_SEGMENT_LENGTH, n - 1));
+    unsigned int i = randomIndex(n - length + 1);
+    // gap of the route without the segment where the segment is inserted
+    unsigned int gap = randomIndex(n - length + 1);
+    if (gap == i)
+    {
+        return false;
+    }
+    move.position1 = i;
+    move.length1 = length;
+    move.position2 = gap;
+
+    unsigned int first = visits[i].stop, last = visits[i + length - 1].stop;
+    unsigned int prev = previousNode(plan, route, i), next = nextNode(plan, route, i + length);
+
+    // neighbours of the insertion gap, indexed in the route without the segment
+    unsigned int a = gap == 0 ? plan.start : visits[gap - 1 < i ? gap - 1 : gap - 1 + length].stop;
+    unsigned int b = gap == n - length ? plan.end : visits[gap < i ? gap : gap + length].stop;
+
+    double closed = matrix.at(prev, next), added_in = matrix.at(a, first), added_out = matrix.at(last, b);
+    if (closed == INF || added_in == INF || added_out == INF)
+    {
+        return false;
+    }
+    move.delta = closed - matrix.at(prev, first) - matrix.at(last, next) + added_in + added_out - matrix.at(a, b);
+
+    return true;
+}
+
+template <class T>
+bool relocateMove(const RoutePlan<T> &plan, const StopMatrix<T> &matrix, Move &move)
+{
+    move.type = RELOCATE;
+    move.route1 = randomIndex(plan.routes.size());
+    move.route2 = randomIndex(plan.routes.size());
+    if (move.route1 == move.route2)
+    {
+        return false;
+    }
+
+    const BusRoute<T> &from = plan.routes[move.route1], &to = plan.routes[move.route2];
+    if (from.visits.empty())
+    {
+        return false;
+    }
+
+    unsigned int i = randomIndex(from.visits.size());
+    const Visit<T> &visit = from.visits[i];
+    if (to.load + visit.workers > to.capacity)
+    {
+        return false;
+    }
+    unsigned int gap = randomIndex(to.visits.size() + 1);
+    move.position1 = i;
+    move.length1 = 1;
+    move.position2 = gap;
+
+    // remove from the first route
+    unsigned int prev = previousNode(plan, from, i), next = nextNode(plan, from, i + 1);
+    move.delta = -matrix.at(prev, visit.stop) - matrix.at(visit.stop, next);
+    if (from.visits.size() > 1)
+    {
+        if (matrix.at(prev, next) == INF)
+        {
+            return false;
+        }
+        move.delta += matrix.at(prev, next);
+    }
+
+    // insert in the second route
+    unsigned int a = previousNode(plan, to, gap), b = nextNode(plan, to, gap);
+    double added_in = matrix.at(a, visit.stop), added_out = matrix.at(visit.stop, b);
+    if (added_in == INF || added_out == INF)
+    {
+        return false;
+    }
+    move.delta += added_in + added_out;
+    if (!to.visits.empty())
+    {
+        move.delta -= matrix.at(a, b);
+    }
+
+    return true;
+}
+
+template <class T>
+bool crossExchangeMove(const RoutePlan<T> &plan, const StopMatrix<T> &matrix, Move &move)
+{
+    move.type = CROSS_EXCHANGE;
+    move.route1 = randomIndex(plan.routes.size());
+    move.route2 = randomIndex(plan.routes.size());
+    if (move.route1 == move.route2)
+    {
+        return false;
+    }
+
+    const BusRoute<T> &route1 = plan.routes[move.route1], &route2 = plan.routes[move.route2];
+    if (route1.visits.empty() || route2.visits.empty())
+    {
+        return false;
+    }
+
+    move.length1 = 1 + randomIndex(std::min<unsigned int>(MAX_SEGMENT_LENGTH, route1.visits.size()));
+    move.length2 = 1 + randomIndex(std::min<unsigned int>(MAX_SEGMENT_LENGTH, route2.visits.size()));
+    move.position1 = randomIndex(route1.visits.size() - move.length1 + 1);
+    move.position2 = randomIndex(route2.visits.size() - move.length2 + 1);
+
+    T workers1 = 0, workers2 = 0;
+    for (unsigned int k = 0; k < move.length1; k++)
+    {
+        workers1 += route1.visits[move.position1 + k].workers;
+    }
+    for (unsigned int k = 0; k < move.length2; k++)
+    {
+        workers2 += route2.visits[move.position2 + k].workers;
+    }
+    if (route1.load - workers1 + workers2 > route1.capacity || route2.load - workers2 + workers1 > route2.capacity)
+    {
+        return false;
+    }
+
+    unsigned int first1 = route1.visits[move.position1].stop, last1 = route1.visits[move.position1 + move.length1 - 1].stop;
+    unsigned int first2 = route2.visits[move.position2].stop, last2 = route2.visits[move.position2 + move.length2 - 1].stop;
+    unsigned int prev1 = previousNode(plan, route1, move.position1), next1 = nextNode(plan, route1, move.position1 + move.length1);
+    unsigned int prev2 = previousNode(plan, route2, move.position2), next2 = nextNode(plan, route2, move.position2 + move.length2);
+
+    double legs[] = {matrix.at(prev1, first2), matrix.at(last2, next1), matrix.at(prev2, first1), matrix.at(last1, next2)};
+    for (double leg : legs)
+    {
+        if (leg == INF)
+        {
+            return false;
+        }
+    }
+    move.delta = legs[0] + legs[1] + legs[2] + legs[3] -
+                 matrix.at(prev1, first1) - matrix.at(last1, next1) - matrix.at(prev2, first2) - matrix.at(last2, next2);
+
+    return true;
+}
+
+/**
+ * Picks a random move and computes how much it changes the plan length, without applying it.
+ * Returns false if the picked move is not valid (capacity exceeded, vertices not connected, ...)
+ */
+template <class T>
+bool randomMove(const RoutePlan<T> &plan, const StopMatrix<T> &matrix, Move &move)
+{
+    // moves between buses only make sense with more than one bus
+    unsigned int number_of_moves = plan.routes.size() > 1 ? 4 : 2;
+    switch (randomIndex(number_of_moves))
+    {
+    case 0:
+        return twoOptMove(plan, matrix, move);
+    case 1:
+        return orOptMove(plan, matrix, move);
+    case 2:
+        return relocateMove(plan, matrix, move);
+    default:
+        return crossExchangeMove(plan, matrix, move);
+    }
+}
+
+template <class T>
+void applyMove(RoutePlan<T> &plan, const Move &move)
+{
+    std::vector<Visit<T>> &visits1 = plan.routes[move.route1].visits;
+    std::vector<Visit<T>> &visits2 = plan.routes[move.route2].visits;
+
+    switch (move.type)
+    {
+    case TWO_OPT:
+        std::reverse(visits1.begin() + move.position1, visits1.begin() + move.position1 + move.length1);
+        break;
+    case OR_OPT:
+    {
+        std::vector<Visit<T>> segment(visits1.begin() + move.position1, visits1.begin() + move.position1 + move.length1);
+        visits1.erase(visits1.begin() + move.position1, visits1.begin() + move.position1 + move.length1);
+        visits1.insert(visits1.begin() + move.position2, segment.begin(), segment.end());
+    }
+    break;
+    case RELOCATE:
+    {
+        Visit<T> visit = visits1[move.position1];
+        visits1.erase(visits1.begin() + move.position1);
+        visits2.insert(visits2.begin() + move.position2, visit);
+        plan.routes[move.route1].load -= visit.workers;
+        plan.routes[move.route2].load += visit.workers;
+    }
+    break;
+    case CROSS_EXCHANGE:
+    {
+        std::vector<Visit<T>> segment1(visits1.begin() + move.position1, visits1.begin() + move.position1 + move.length1);
+        std::vector<Visit<T>> segment2(visits2.begin() + move.position2, visits2.begin() + move.position2 + move.length2);
+        visits1.erase(visits1.begin() + move.position1, visits1.begin() + move.position1 + move.length1);
+        visits1.insert(visits1.begin() + move.position1, segment2.begin(), segment2.end());
+        visits2.erase(visits2.begin() + move.position2, visits2.begin() + move.position2 + move.length2);
+        visits2.insert(visits2.begin() + move.position2, segment1.begin(), segment1.end());
+        for (const Visit<T> &visit : segment1)
+        {
+            plan.routes[move.route1].load -= visit.workers;
+            plan.routes[move.route2].load += visit.workers;
+        }
+        for (const Visit<T> &visit : segment2)
+        {
+            plan.routes[move.route2].load -= visit.workers;
+            plan.routes[move.route1].load += visit.workers;
+        }
+    }
+    break;
+    }
+}
+
+/**
+ * Held-Karp dynamic programming: shortest route of a single bus from start to end through all the visits.
+ * The table is a flat array indexed by [subset of visited stops][last stop], so the
+ * entries read while extending one subset are contiguous.
+ * Reorders the visits of the route and returns its length (INF if no route exists)
+ */
+template <class T>
+double heldKarp(const RoutePlan<T> &plan, BusRoute<T> &route, const StopMatrix<T> &matrix)
+{
+    const std::vector<Visit<T>> &visits = route.visits;
+    unsigned int n = visits.size();
+    if (n == 0)
+    {
+        return 0;
+    }
+
+    unsigned int full = (1u << n) - 1;
+    std::vector<double> table((full + 1) * n, INF);
+    std::vector<unsigned char> previous((full + 1) * n, 0);
+
+    for (unsigned int j = 0; j < n; j++)
+    {
+        table[(1u << j) * n + j] = matrix.at(plan.start, visits[j].stop);
+    }
+
+    for (unsigned int subset = 1; subset <= full; subset++)
+    {
+        const double *row = &table[subset * n];
+        for (unsigned int last = 0; last < n; last++)
+        {
+            if (row[last] == INF || !(subset & (1u << last)))
+            {
+                continue;
+            }
+            for (unsigned int next = 0; next < n; next++)
+            {
+                if (subset & (1u << next))
+                {
+                    continue;
+                }
+                double leg = matrix.at(visits[last].stop, visits[next].stop);
+                if (leg == INF)
+                {
+                    continue;
+                }
+                unsigned int entry = (subset | (1u << next)) * n + next;
+                if (row[last] + leg < table[entry])
+                {
+                    table[entry] = row[last] + leg;
+                    previous[entry] = last;
+                }
+            }
+        }
+    }
+
+    double best = INF;
+    unsigned int best_last = 0;
+    for (unsigned int last = 0; last < n; last++)
+    {
+        double leg = matrix.at(visits[last].stop, plan.end);
+        if (table[full * n + last] != INF && leg != INF && table[full * n + last] + leg < best)
+        {
+            best = table[full * n + last] + leg;
+            best_last = last;
+        }
+    }
+    if (best == INF)
+    {
+        return INF;
+    }
+
+    // walk back the table to rebuild the order of the visits
+    std::vector<Visit<T>> ordered(n);
+    unsigned int subset = full, last = best_last;
+    for (unsigned int position = n; position-- > 0;)
+    {
+        ordered[position] = visits[last];
+        unsigned int before = previous[subset * n + last];
+        subset &= ~(1u << last);
+        last = before;
+    }
+    route.visits = ordered;
+
+    return best;
+}
+
+/**
+ * Ruin step of the large neighbourhood search: removes up to RUIN_FRACTION of the visits,
+ * either the visits closest to a random seed visit or random visits, and returns them
+ */
+template <class T>
+std::vector<Visit<T>> ruinRoutes(RoutePlan<T> &plan, const StopMatrix<T> &matrix)
+{
+    // (route, position) of every visit
+    std::vector<std::pair<unsigned int, unsigned int>> positions;
+    for (unsigned int r = 0; r < plan.routes.size(); r++)
+    {
+        for (unsigned int i = 0; i < plan.routes[r].visits.size(); i++)
+        {
+            positions.push_back({r, i});
+        }
+    }
+
+    std::vector<Visit<T>> removed;
+    if (positions.empty())
+    {
+        return removed;
+    }
+
+    unsigned int max_removed = std::max<unsigned int>(1, positions.size() * RUIN_FRACTION);
+    unsigned int number_removed = 1 + randomIndex(max_removed);
+
+    if (randomIndex(2) == 0)
+    {
+        // spatial cluster: the visits closest to a random seed
+        std::pair<unsigned int, unsigned int> seed = positions[randomIndex(positions.size())];
+        unsigned int seed_stop = plan.routes[seed.first].visits[seed.second].stop;
+        auto distance_to_seed = [&](const std::pair<unsigned int, unsigned int> &position) {
+            unsigned int stop = plan.routes[position.first].visits[position.second].stop;
+            return std::min(matrix.at(seed_stop, stop), matrix.at(stop, seed_stop));
+        };
+        std::partial_sort(positions.begin(), positions.begin() + number_removed, positions.end(),
+                          [&](const std::pair<unsigned int, unsigned int> &a, const std::pair<unsigned int, unsigned int> &b) {
+                              return distance_to_seed(a) < distance_to_seed(b);
+                          });
+    }
+    else
+    {
+        // random visits
+        for (unsigned int i = 0; i < number_removed; i++)
+        {
+            std::swap(positions[i], positions[i + randomIndex(positions.size() - i)]);
+        }
+    }
+    positions.resize(number_removed);
+
+    // remove from the back of each route so the other positions stay valid
+    std::sort(positions.rbegin(), positions.rend());
+    for (const std::pair<unsigned int, unsigned int> &position : positions)
+    {
+        BusRoute<T> &route = plan.routes[position.first];
+        removed.push_back(route.visits[position.second]);
+        route.load -= route.visits[position.second].workers;
+        route.visits.erase(route.visits.begin() + position.second);
+    }
+
+    return removed;
+}
+
+/**
+ * Extra length of inserting a stop in a gap of a route, INF if some leg does not exist
+ */
+template <class T>
+double insertionCost(const RoutePlan<T> &plan, const BusRoute<T> &route, unsigned int gap, unsigned int stop, const StopMatrix<T> &matrix)
+{
+    unsigned int a = previousNode(plan, route, gap), b = nextNode(plan, route, gap);
+    double added_in = matrix.at(a, stop), added_out = matrix.at(stop, b);
+    if (added_in == INF || added_out == INF)
+    {
+        return INF;
+    }
+    return route.visits.empty() ? added_in + added_out : added_in + added_out - matrix.at(a, b);
+}
+
+/**
+ * Recreate step of the large neighbourhood search: inserts the removed visits, biggest first,
+ * at their cheapest position among the buses with room for them. A visit that does not fit
+ * in any single bus is split between the buses with free seats.
+ * Returns false if some visit could not be inserted
+ */
+template <class T>
+bool recreateRoutes(RoutePlan<T> &plan, std::vector<Visit<T>> removed, const StopMatrix<T> &matrix)
+{
+    std::sort(removed.begin(), removed.end(), [](const Visit<T> &a, const Visit<T> &b) { return a.workers > b.workers; });
+
+    for (Visit<T> visit : removed)
+    {
+        while (visit.workers > 0)
+        {
+            double best_cost = INF;
+            int best_route = -1;
+            unsigned int best_gap = 0;
+            bool best_fits = false;
+
+            for (unsigned int r = 0; r < plan.routes.size(); r++)
+            {
+                const BusRoute<T> &route = plan.routes[r];
+                T free_seats = route.capacity - route.load;
+                bool fits = free_seats >= visit.workers;
+                if (free_seats <= 0 || (best_fits && !fits))
+                {
+                    continue;
+                }
+                for (unsigned int gap = 0; gap <= route.visits.size(); gap++)
+                {
+                    double cost = insertionCost(plan, route, gap, visit.stop, matrix);
+                    if (cost != INF && (cost < best_cost || (fits && !best_fits)))
+                    {
+                        best_cost = cost;
+                        best_route = r;
+                        best_gap = gap;
+                        best_fits = fits;
+                    }
+                }
+            }
+
+            if (best_route == -1)
+            {
+                return false;
+            }
+
+            BusRoute<T> &route = plan.routes[best_route];
+            T workers = std::min(visit.workers, route.capacity - route.load);
+            route.visits.insert(route.visits.begin() + best_gap, {visit.stop, workers});
+            route.load += workers;
+            visit.workers -= workers;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Routes of a plan by vertex id
+ */
+template <class T>
+std::vector<SavedRoute<T>> saveRoutes(const RoutePlan<T> &plan, const StopMatrix<T> &matrix)
+{
+    std::vector<SavedRoute<T>> saved;
+    for (const BusRoute<T> &route : plan.routes)
+    {
+        SavedRoute<T> saved_route;
+        saved_route.capacity = route.capacity;
+        for (const Visit<T> &visit : route.visits)
+        {
+            saved_route.stops.push_back(matrix.getVertexId(visit.stop));
+        }
+        saved.push_back(saved_route);
+    }
+    return saved;
+}
+
+/**
+ * Initial plan from the routes of a previous plan: each saved route is given to an unused bus
+ * of the same capacity and keeps, in the same order, its bus stops that still exist.
+ * The new bus stops, the stops of routes left without a bus and the workers that no longer
+ * fit are then inserted with recreateRoutes.
+ * Returns an empty plan (no routes) if some visit could not be inserted
+ */
+template <class T>
+RoutePlan<T> warmStartRoutes(unsigned int start, unsigned int end, const std::vector<Visit<T>> &visits,
+                             const std::vector<T> &capacities, const std::vector<SavedRoute<T>> &saved,
+                             const StopMatrix<T> &matrix)
+{
+    RoutePlan<T> plan;
+    plan.start = start;
+    plan.end = end;
+    for (T capacity : capacities)
+    {
+        BusRoute<T> route;
+        route.capacity = capacity;
+        plan.routes.push_back(route);
+    }
+
+    // workers of each bus stop still to be picked up, by vertex id
+    std::unordered_map<T, unsigned int> visit_of_vertex;
+    std::vector<T> remaining;
+    for (unsigned int i = 0; i < visits.size(); i++)
+    {
+        visit_of_vertex[matrix.getVertexId(visits[i].stop)] = i;
+        remaining.push_back(visits[i].workers);
+    }
+
+    std::vector<bool> used(plan.routes.size(), false);
+    for (const SavedRoute<T> &saved_route : saved)
+    {
+        unsigned int r = 0;
+        while (r < plan.routes.size() && (used[r] || plan.routes[r].capacity != saved_route.capacity))
+        {
+            r++;
+        }
+        if (r == plan.routes.size())
+        {
+            continue;
+        }
+        used[r] = true;
+
+        BusRoute<T> &route = plan.routes[r];
+        for (T vertex_id : saved_route.stops)
+        {
+            auto it = visit_of_vertex.find(vertex_id);
+            if (it == visit_of_vertex.end() || remaining[it->second] <= 0)
+            {
+                continue;
+            }
+            T workers = std::min(remaining[it->second], route.capacity - route.load);
+            if (workers > 0)
+            {
+                route.visits.push_back({visits[it->second].stop, workers});
+                route.load += workers;
+                remaining[it->second] -= workers;
+            }
+        }
+    }
+
+    std::vector<Visit<T>> removed;
+    for (unsigned int i = 0; i < visits.size(); i++)
+    {
+        if (remaining[i] > 0)
+        {
+            removed.push_back({visits[i].stop, remaining[i]});
+        }
+    }
+    if (!recreateRoutes(plan, removed, matrix))
+    {
+        plan.routes.clear();
+    }
+
+    return plan;
+}
+
+#endif /* ROUTING_H_ */
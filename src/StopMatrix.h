@@ -0,0 +1,314 @@
+/*
+ * StopMatrix.h
+ */
+#ifndef STOPMATRIX_H_
+#define STOPMATRIX_H_
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+
+#include "Graph.h"
+#include "ThreadPool.h"
+#include "DistanceCache.h"
+
+/************************* StopMatrix  **************************/
+
+/**
+ * Dense matrix with the shortest distances between a set of vertices
+ * (the bus stops of a company and the end points of its trips).
+ * Rows and columns follow the order of the vertices given to build,
+ * unreachable pairs are stored as INF. Built on any Graph<T, W, Direction>,
+ * the distances are kept as doubles whatever the weight type of the graph
+ */
+template <class T>
+class StopMatrix
+{
+    std::vector<T> vertices;       // vertex id of each row/column
+    std::vector<double> distances; // row-major, size() * size() entries
+    bool symmetric = true;
+
+    template <class G>
+    void searchMissing(const G &graph, std::vector<bool> &known, const std::vector<unsigned int> &rows,
+                       DistanceCache<T> *cache);
+    void checkSymmetric();
+
+public:
+    StopMatrix();
+    template <class G>
+    void build(const G &graph, const std::vector<T> &vertices, DistanceCache<T> *cache = nullptr);
+    template <class G>
+    void update(const G &graph, const std::vector<T> &vertices, DistanceCache<T> *cache = nullptr);
+
+    unsigned int size() const;
+    T getVertexId(unsigned int index) const;
+    bool isSymmetric() const;
+    double at(unsigned int from, unsigned int to) const;
+};
+
+/**
+ * .cpp
+*/
+template <class T>
+StopMatrix<T>::StopMatrix() {}
+
+/**
+ * Fills the entries that are not known yet: first from the cache, if there is one, and then with
+ * one Dijkstra per row that still misses entries, as parallel tasks of the default thread pool.
+ * Rows are searched in the given order and each search stops once it has reached the vertices
+ * its row misses. On undirected graphs each pair is searched once: a row does not search the
+ * vertices of the rows searched before it, and every distance found is also copied to the
+ * symmetric entry. The distances searched are added to the cache
+ */
+template <class T>
+template <class G>
+void StopMatrix<T>::searchMissing(const G &graph, std::vector<bool> &known, const std::vector<unsigned int> &rows,
+                                  DistanceCache<T> *cache)
+{
+    unsigned int n = vertices.size();
+    bool undirected = graph.isUndirected();
+
+    if (cache != nullptr && cache->lookup(vertices, distances, known))
+    {
+        return;
+    }
+    if (undirected)
+    {
+        for (unsigned int i = 0; i < n; i++)
+        {
+            for (unsigned int j = 0; j < n; j++)
+            {
+                if (!known[i * n + j] && known[j * n + i])
+                {
+                    distances[i * n + j] = distances[j * n + i];
+                    known[i * n + j] = true;
+                }
+            }
+        }
+    }
+
+    std::vector<int> indices(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        indices[i] = graph.findVertexIndex(vertices[i]);
+    }
+
+    // columns searched by each row
+    std::vector<bool> searched_before(n, false);
+    std::vector<std::vector<unsigned int>> columns(rows.size());
+    for (unsigned int k = 0; k < rows.size(); k++)
+    {
+        unsigned int i = rows[k];
+        for (unsigned int j = 0; j < n; j++)
+        {
+            if (!known[i * n + j] && !(undirected && searched_before[j]))
+            {
+                columns[k].push_back(j);
+            }
+        }
+        searched_before[i] = !columns[k].empty();
+    }
+
+    TaskGroup searches;
+    for (unsigned int k = 0; k < rows.size(); k++)
+    {
+        unsigned int i = rows[k];
+        if (columns[k].empty())
+        {
+            continue;
+        }
+        searches.run([this, &graph, &indices, &columns, undirected, i, k, n]() {
+            std::vector<unsigned int> targets;
+            for (unsigned int j : columns[k])
+            {
+                if (indices[j] != -1)
+                {
+                    targets.push_back(indices[j]);
+                }
+            }
+
+            typename G::Paths paths;
+            if (indices[i] != -1)
+            {
+                graph.dijkstraShortestPath(indices[i], paths, targets);
+            }
+            for (unsigned int j : columns[k])
+            {
+                distances[i * n + j] = indices[i] == -1 || indices[j] == -1 ? INF : graph.getPathLength(indices[j], paths);
+                if (undirected)
+                {
+                    // (j, i) is only written by this row, since row j does not search column i
+                    distances[j * n + i] = distances[i * n + j];
+                }
+            }
+        });
+    }
+    searches.wait();
+
+    std::vector<bool> computed(n * n, false);
+    for (unsigned int k = 0; k < rows.size(); k++)
+    {
+        for (unsigned int j : columns[k])
+        {
+            computed[rows[k] * n + j] = true;
+            known[rows[k] * n + j] = true;
+            if (undirected)
+            {
+                computed[j * n + rows[k]] = true;
+                known[j * n + rows[k]] = true;
+            }
+        }
+    }
+    if (cache != nullptr)
+    {
+        cache->insert(vertices, distances, computed);
+    }
+}
+
+template <class T>
+void StopMatrix<T>::checkSymmetric()
+{
+    unsigned int n = vertices.size();
+    symmetric = true;
+    for (unsigned int i = 0; i < n && symmetric; i++)
+    {
+        for (unsigned int j = i + 1; j < n; j++)
+        {
+            if (distances[i * n + j] != distances[j * n + i])
+            {
+                symmetric = false;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Calculates the distances between all the vertices, reusing the ones in the cache if there is one
+ */
+template <class T>
+template <class G>
+void StopMatrix<T>::build(const G &graph, const std::vector<T> &vertices, DistanceCache<T> *cache)
+{
+    unsigned int n = vertices.size();
+    this->vertices = vertices;
+    this->distances.assign(n * n, INF);
+
+    std::vector<unsigned int> rows(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        rows[i] = i;
+    }
+
+    if (graph.isUndirected())
+    {
+        // farthest from the centre first: the vertices left for the last searches are close together,
+        // so those searches stop early
+        double x = 0, y = 0;
+        std::vector<int> row_vertices(n);
+        for (unsigned int i = 0; i < n; i++)
+        {
+            row_vertices[i] = graph.findVertexIndex(vertices[i]);
+            if (row_vertices[i] != -1)
+            {
+                x += graph.getX(row_vertices[i]) / n;
+                y += graph.getY(row_vertices[i]) / n;
+            }
+        }
+        std::vector<double> radius(n, 0);
+        for (unsigned int i = 0; i < n; i++)
+        {
+            if (row_vertices[i] != -1)
+            {
+                radius[i] = hypot(graph.getX(row_vertices[i]) - x, graph.getY(row_vertices[i]) - y);
+            }
+        }
+        std::sort(rows.begin(), rows.end(), [&radius](unsigned int a, unsigned int b) { return radius[a] > radius[b]; });
+    }
+
+    std::vector<bool> known(n * n, false);
+    searchMissing(graph, known, rows, cache);
+    checkSymmetric();
+}
+
+/**
+ * Changes the vertices of the matrix (in any order), keeping the distances between the vertices
+ * it already had, so adding a bus stop costs one Dijkstra and removing one costs none.
+ * The columns of the new vertices come with their rows on undirected graphs (searchMissing),
+ * otherwise the rows of the old vertices are searched again for them
+ */
+template <class T>
+template <class G>
+void StopMatrix<T>::update(const G &graph, const std::vector<T> &vertices, DistanceCache<T> *cache)
+{
+    std::unordered_map<T, unsigned int> old_rows;
+    for (unsigned int i = 0; i < this->vertices.size(); i++)
+    {
+        old_rows[this->vertices[i]] = i;
+    }
+
+    unsigned int n = vertices.size(), old_n = this->vertices.size();
+    std::vector<int> old(n, -1);
+    std::vector<unsigned int> rows, old_rows_kept;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        auto it = old_rows.find(vertices[i]);
+        if (it == old_rows.end())
+        {
+            rows.push_back(i);
+        }
+        else
+        {
+            old[i] = it->second;
+            old_rows_kept.push_back(i);
+        }
+    }
+
+    std::vector<double> updated(n * n, INF);
+    std::vector<bool> known(n * n, false);
+    for (unsigned int i : old_rows_kept)
+    {
+        for (unsigned int j : old_rows_kept)
+        {
+            updated[i * n + j] = distances[old[i] * old_n + old[j]];
+            known[i * n + j] = true;
+        }
+    }
+    this->vertices = vertices;
+    this->distances.swap(updated);
+
+    // new rows first
+    rows.insert(rows.end(), old_rows_kept.begin(), old_rows_kept.end());
+    if (rows.size() > old_rows_kept.size())
+    {
+        searchMissing(graph, known, rows, cache);
+    }
+    checkSymmetric();
+}
+
+template <class T>
+unsigned int StopMatrix<T>::size() const
+{
+    return this->vertices.size();
+}
+
+template <class T>
+T StopMatrix<T>::getVertexId(unsigned int index) const
+{
+    return this->vertices[index];
+}
+
+template <class T>
+bool StopMatrix<T>::isSymmetric() const
+{
+    return this->symmetric;
+}
+
+template <class T>
+double StopMatrix<T>::at(unsigned int from, unsigned int to) const
+{
+    return this->distances[from * vertices.size() + to];
+}
+
+#endif /* STOPMATRIX_H_ */
@@ -0,0 +1,400 @@
+/*
+ * ThreadPool.h
+ */
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <chrono>
+
+/************************* ThreadPool  **************************/
+
+class TaskGroup;
+
+/**
+ * Work-stealing thread pool. Each worker has its own deque of tasks: it runs the newest task
+ * of its deque (last in, first out, so nested tasks run while their data is still in cache)
+ * and, when it is empty, steals the oldest task of another deque.
+ * Tasks submitted by a worker go to its own deque, other threads spread them over the deques.
+ * Tasks may submit and wait for more tasks (TaskGroup), waiting threads run pending tasks of their group
+ * and of the groups nested in it
+ */
+class ThreadPool
+{
+    struct Task
+    {
+        std::function<void()> function;
+        const TaskGroup *group; // group of the task, nullptr if none
+    };
+
+    struct Worker
+    {
+        std::deque<Task> tasks;
+        std::mutex mutex;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<unsigned int> queued;     // tasks waiting in the deques
+    std::atomic<unsigned int> next_queue; // deque of the next task submitted from outside the pool
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    static int &currentWorker();
+    static ThreadPool *&currentPool();
+    bool popTask(int worker, std::function<void()> &task, const TaskGroup *group);
+    void workerLoop(int worker);
+
+public:
+    explicit ThreadPool(unsigned int number_of_threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned int size() const;
+    void submit(std::function<void()> task, const TaskGroup *group = nullptr);
+    bool runPendingTask(const TaskGroup *group = nullptr);
+};
+
+/**
+ * Pool shared by the graph and the manager, with one worker per hardware thread
+ */
+inline ThreadPool &defaultThreadPool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+/************************* TaskGroup  **************************/
+
+/**
+ * Set of tasks submitted to a pool that can be waited for together.
+ * A group created inside a task of another group is nested in it. wait() runs the queued tasks
+ * of the group and of the groups nested in it until the group is done, so a task can start a group
+ * of smaller tasks and wait for them without leaving the pool idle, and without running unrelated
+ * tasks on its stack.
+ * The first exception thrown by a task is rethrown by wait()
+ */
+class TaskGroup
+{
+    ThreadPool &pool;
+    const TaskGroup *parent; // group of the task that created this one, nullptr if none
+    std::atomic<unsigned int> pending;
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::exception_ptr exception;
+
+    struct Finish; // marks a task of the group as finished, even if it throws
+
+    static const TaskGroup *&currentGroup();
+    void fail(std::exception_ptr task_exception);
+    void waitTasks();
+
+public:
+    explicit TaskGroup(ThreadPool &pool = defaultThreadPool());
+    ~TaskGroup();
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    template <class Function>
+    void run(Function task);
+    bool done() const;
+    bool contains(const TaskGroup *group) const;
+    void wait();
+};
+
+/**
+ * .cpp
+*/
+
+inline ThreadPool::ThreadPool(unsigned int number_of_threads) : queued(0), next_queue(0)
+{
+    number_of_threads = std::max(1u, number_of_threads);
+    for (unsigned int i = 0; i < number_of_threads; i++)
+    {
+        workers.emplace_back(new Worker());
+    }
+    for (unsigned int i = 0; i < number_of_threads; i++)
+    {
+        threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+inline ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+/**
+ * Index of the worker running on this thread, -1 outside the pool
+ */
+inline int &ThreadPool::currentWorker()
+{
+    thread_local int worker = -1;
+    return worker;
+}
+
+inline ThreadPool *&ThreadPool::currentPool()
+{
+    thread_local ThreadPool *pool = nullptr;
+    return pool;
+}
+
+inline unsigned int ThreadPool::size() const
+{
+    return workers.size();
+}
+
+struct TaskGroup::Finish
+{
+    TaskGroup &group;
+
+    ~Finish()
+    {
+        // under the lock, so the waiting thread can not destroy the group before it is notified
+        std::lock_guard<std::mutex> lock(group.mutex);
+        if (--group.pending == 0)
+        {
+            group.finished.notify_all();
+        }
+    }
+};
+
+template <class Function>
+void TaskGroup::run(Function task)
+{
+    pending++;
+    pool.submit(
+        [this, task]() {
+            Finish finish{*this};
+            const TaskGroup *outer = currentGroup();
+            currentGroup() = this;
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                fail(std::current_exception());
+            }
+            currentGroup() = outer;
+        },
+        this);
+}
+
+inline void ThreadPool::submit(std::function<void()> task, const TaskGroup *group)
+{
+    int worker = currentPool() == this ? currentWorker() : -1;
+    if (worker == -1)
+    {
+        worker = next_queue++ % workers.size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(workers[worker]->mutex);
+        workers[worker]->tasks.push_back({std::move(task), group});
+    }
+    queued++;
+
+    // taking the lock makes sure a worker going to sleep sees the new task
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    wake.notify_one();
+}
+
+/**
+ * Takes the newest task of the worker's deque or, if it is empty, steals the oldest task of another deque.
+ * worker is -1 for threads outside the pool, which only steal.
+ * If group is not nullptr, only tasks of that group and of the groups nested in it are taken
+ */
+inline bool ThreadPool::popTask(int worker, std::function<void()> &task, const TaskGroup *group)
+{
+    if (queued == 0)
+    {
+        return false;
+    }
+
+    if (worker != -1)
+    {
+        std::deque<Task> &tasks = workers[worker]->tasks;
+        std::lock_guard<std::mutex> lock(workers[worker]->mutex);
+        for (auto it = tasks.rbegin(); it != tasks.rend(); it++)
+        {
+            if (group == nullptr || group->contains(it->group))
+            {
+                task = std::move(it->function);
+                tasks.erase(std::next(it).base());
+                queued--;
+                return true;
+            }
+        }
+    }
+
+    unsigned int n = workers.size();
+    unsigned int first = worker == -1 ? 0 : worker + 1;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        Worker &victim = *workers[(first + i) % n];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        for (auto it = victim.tasks.begin(); it != victim.tasks.end(); it++)
+        {
+            if (group == nullptr || group->contains(it->group))
+            {
+                task = std::move(it->function);
+                victim.tasks.erase(it);
+                queued--;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Runs one pending task on the calling thread (only of the given group or nested in it, if not nullptr),
+ * returns false if there was none
+ */
+inline bool ThreadPool::runPendingTask(const TaskGroup *group)
+{
+    std::function<void()> task;
+    if (!popTask(currentPool() == this ? currentWorker() : -1, task, group))
+    {
+        return false;
+    }
+    task();
+    return true;
+}
+
+inline void ThreadPool::workerLoop(int worker)
+{
+    currentWorker() = worker;
+    currentPool() = this;
+
+    std::function<void()> task;
+    while (true)
+    {
+        if (popTask(worker, task, nullptr))
+        {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [this]() { return queued > 0 || stopping; });
+        if (stopping && queued == 0)
+        {
+            return;
+        }
+    }
+}
+
+inline TaskGroup::TaskGroup(ThreadPool &pool) : pool(pool), parent(currentGroup()), pending(0) {}
+
+/**
+ * Group of the task running on this thread, nullptr outside tasks of a group
+ */
+inline const TaskGroup *&TaskGroup::currentGroup()
+{
+    thread_local const TaskGroup *group = nullptr;
+    return group;
+}
+
+/**
+ * Waits for the tasks still running; their exceptions are dropped, a destructor can not throw
+ */
+inline TaskGroup::~TaskGroup()
+{
+    waitTasks();
+}
+
+inline bool TaskGroup::done() const
+{
+    return pending == 0;
+}
+
+/**
+ * True if group is this group or nested in it. The groups in between are alive while
+ * a task of group is queued, since each one waits for its tasks before it is destroyed
+ */
+inline bool TaskGroup::contains(const TaskGroup *group) const
+{
+    for (; group != nullptr; group = group->parent)
+    {
+        if (group == this)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Keeps the first exception thrown by a task of the group
+ */
+inline void TaskGroup::fail(std::exception_ptr task_exception)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!exception)
+    {
+        exception = task_exception;
+    }
+}
+
+/**
+ * Runs the queued tasks of the group and of the groups nested in it on the calling thread until
+ * the group is done. While none is queued it sleeps briefly, since the tasks running on other
+ * threads may still queue nested tasks
+ */
+inline void TaskGroup::waitTasks()
+{
+    while (pending > 0)
+    {
+        if (pool.runPendingTask(this))
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait_for(lock, std::chrono::microseconds(100), [this]() { return pending == 0; });
+    }
+
+    // always takes the lock, the last task may still be notifying
+    std::lock_guard<std::mutex> lock(mutex);
+}
+
+/**
+ * Waits for all the tasks of the group and rethrows the first exception thrown by one of them
+ */
+inline void TaskGroup::wait()
+{
+    waitTasks();
+
+    std::exception_ptr task_exception;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::swap(task_exception, exception);
+    }
+    if (task_exception)
+    {
+        std::rethrow_exception(task_exception);
+    }
+}
+
+#endif /* THREADPOOL_H_ */
@@ -0,0 +1,157 @@
+/*
+ * benchmark.cpp
+ * Compares the thread pool (ThreadPool.h) with std::async on the tasks of the planner:
+ * one shortest path search per source and one annealing chain per company.
+ * Also compares the savings plan, the annealing (20000 and 100000 iterations) and ruin and recreate
+ * on a company with many bus stops.
+ * Usage: ./benchmark [map] [number of tasks]
+ */
+#include <future>
+
+#include "Manager.h"
+
+/**
+ * Seconds taken by function, best of a few runs
+ */
+template <class Function>
+double timeIt(Function function)
+{
+    double best = INF;
+    for (unsigned int run = 0; run < 3; run++)
+    {
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        function();
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1000000.0);
+    }
+    return best;
+}
+
+/**
+ * Runs task(0), ..., task(n - 1) sequentially, with std::async and with the thread pool.
+ * std::async runs one chunk of consecutive tasks per hardware thread, as a fixed set of threads would
+ */
+template <class Function>
+void compare(std::string name, unsigned int n, Function task)
+{
+    double sequential = timeIt([&]() {
+        for (unsigned int i = 0; i < n; i++)
+        {
+            task(i);
+        }
+    });
+    unsigned int chunks = std::max(1u, std::min(n, std::thread::hardware_concurrency()));
+    double async = timeIt([&]() {
+        std::vector<std::future<void>> futures;
+        for (unsigned int c = 0; c < chunks; c++)
+        {
+            futures.push_back(std::async(std::launch::async, [&task, c, chunks, n]() {
+                for (unsigned int i = c * n / chunks; i < (c + 1) * n / chunks; i++)
+                {
+                    task(i);
+                }
+            }));
+        }
+        for (std::future<void> &future : futures)
+        {
+            future.get();
+        }
+    });
+    double pool = timeIt([&]() { parallelFor(n, task); });
+
+    std::cout << name << " (" << n << " tasks): sequential " << sequential << "[s], std::async (" << chunks
+              << " chunks) " << async << "[s], thread pool " << pool << "[s]\n";
+}
+
+int main(int argc, char *argv[])
+{
+    std::string city_name = argc > 1 ? argv[1] : "testing";
+    unsigned int n = argc > 2 ? atoi(argv[2]) : 200;
+
+    Manager<long> manager;
+    manager.getGraph().loadNodesAndEdges(city_name);
+    const auto &vertices = manager.getGraph().getVertexSet();
+    if (vertices.empty())
+    {
+        return 1;
+    }
+    std::cout << "Map " << city_name << ", " << vertices.size() << " vertices, "
+              << defaultThreadPool().size() << " pool threads\n";
+
+    srand(0);
+    std::vector<unsigned int> sources(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        sources[i] = rand() % vertices.size();
+    }
+    compare("Shortest path searches", n, [&](unsigned int i) {
+        Graph<long>::Paths paths;
+        manager.getGraph().dijkstraShortestPath(sources[i], paths);
+    });
+
+    // small companies of 12 bus stops, one bus each
+    std::vector<long> stops;
+    for (unsigned int i = 0; i < 14; i++)
+    {
+        stops.push_back(vertices[rand() % vertices.size()]);
+    }
+    StopMatrix<long> distances;
+    distances.build(manager.getGraph(), stops);
+    std::vector<Visit<long>> visits;
+    for (unsigned int i = 0; i < 12; i++)
+    {
+        visits.push_back({i, 1});
+    }
+    compare("Annealing chains", n, [&](unsigned int i) {
+        RoutePlan<long> plan = fillRoutes<long>(12, 13, visits, {20});
+        annealRoutes(plan, distances, 2000, false);
+    });
+
+    // one company with many bus stops, in the largest strongly connected component so every pair is reachable:
+    // annealing alone against ruin and recreate from the annealed plan, as optimizePlan runs them
+    manager.getGraph().updateComponents();
+    int largest = manager.getGraph().getLargestComponent();
+    std::vector<long> reachable;
+    for (long vertex : vertices)
+    {
+        if (manager.getGraph().getComponent(vertex) == largest)
+        {
+            reachable.push_back(vertex);
+        }
+    }
+    unsigned int num_many_stops = 200;
+    std::vector<long> many_stops;
+    for (unsigned int i = 0; i < num_many_stops + 2; i++)
+    {
+        many_stops.push_back(reachable[rand() % reachable.size()]);
+    }
+    StopMatrix<long> many_distances;
+    many_distances.build(manager.getGraph(), many_stops);
+    std::vector<Visit<long>> many_visits;
+    long workers = 0;
+    for (unsigned int i = 0; i < num_many_stops; i++)
+    {
+        many_visits.push_back({i, 1 + rand() % 5});
+        workers += many_visits.back().workers;
+    }
+    std::vector<long> capacities((workers + 29) / 30, 30);
+    RoutePlan<long> initial_plan = savingsRoutes<long>(num_many_stops, num_many_stops + 1, many_visits, capacities, many_distances);
+    std::cout << "Company with " << num_many_stops << " bus stops, savings: distance " << planLength(initial_plan, many_distances) << "\n";
+
+    // (annealing iterations, ruin and recreate iterations)
+    std::vector<std::pair<unsigned int, unsigned int>> runs = {{20000, 0}, {100000, 0}, {100000, 1000}};
+    for (auto &run : runs)
+    {
+        RoutePlan<long> plan;
+        double seconds = timeIt([&]() {
+            randomGenerator().seed(0);
+            plan = initial_plan;
+            annealRoutes(plan, many_distances, run.first);
+            ruinAndRecreateRoutes(plan, many_distances, run.second);
+        });
+        std::cout << "Company with " << num_many_stops << " bus stops, " << run.first << " annealing + " << run.second
+                  << " ruin and recreate iterations: distance " << planLength(plan, many_distances) << ", " << seconds << "[s]\n";
+    }
+
+    return 0;
+}
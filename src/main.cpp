@@ -6,9 +6,10 @@
 int main()
 {
 	srand(time(NULL));
-	Manager<long> *manager = new Manager<long>();
-	Interface<long> interface(manager);
-	interface.chooseMap();
+	Manager<long> manager;
+	Interface<long> interface(&manager);
+	while (interface.chooseMap())
+		;
 
 	return 0;
 }